@@ -0,0 +1,162 @@
+/*
+  Created: October 18, 2026
+  License: Lemonadeware. Buy me a lemonade (or other) someday.
+
+  This sketch demonstrates how to stage a firmware image in A/B slots on SPI flash.
+
+  The image is streamed into the inactive slot, checked, then committed.
+  The new image stays pending until it is confirmed. If it is never confirmed
+  (e.g. it crashes on its first boot) you can roll back to the previous image.
+
+  Here the "image" is just a counting pattern. In a real application the data would
+  arrive from a radio or a serial link, a few hundred bytes at a time.
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17115
+*/
+
+const byte PIN_FLASH_CS = 8; // Change this to match the Chip Select pin on your board
+
+#include <SPI.h>
+
+#include <SparkFun_SPI_SerialFlash.h> //Click here to get the library: http://librarymanager/All#SparkFun_SPI_SerialFlash
+#include <SparkFun_SPI_SerialFlash_Slots.h>
+SFE_SPI_FLASH myFlash;
+SFE_SPI_FLASH_SLOTS mySlots;
+
+const uint32_t SLOTS_BASE_ADDRESS = 0x100000; // The metadata and both slots live above 1MB. Must be a multiple of SFE_FLASH_SECTOR_SIZE
+const uint32_t SLOT_SIZE = 0x40000; // 256KB per slot. Must be a multiple of SFE_FLASH_SECTOR_SIZE
+const uint32_t IMAGE_SIZE = 20000; // The size of our pretend image
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun SPI SerialFlash A/B Slots Example"));
+
+  if (myFlash.begin(PIN_FLASH_CS) == false)
+  {
+    Serial.println(F("SPI Flash not detected. Check wiring. Maybe you need to pull up WP/IO2 and HOLD/IO3? Freezing..."));
+    while (1);
+  }
+
+  if (mySlots.begin(myFlash, SLOTS_BASE_ADDRESS, SLOT_SIZE) == false)
+  {
+    Serial.println(F("Could not read the slot metadata. Freezing..."));
+    while (1);
+  }
+
+  printSlots();
+
+  if (mySlots.isPending() == true)
+  {
+    // The last image was committed but never confirmed. A real application would
+    // confirm once it has checked the new firmware is working, or roll back if not.
+    Serial.println(F("Confirming the pending image"));
+    mySlots.confirm();
+    printSlots();
+  }
+}
+
+void loop()
+{
+  Serial.println();
+  Serial.println(F("s)tage and commit a new image"));
+  Serial.println(F("c)onfirm the pending image"));
+  Serial.println(F("r)oll back to the previous image"));
+  Serial.println();
+
+  while (Serial.available()) Serial.read(); //Clear the RX buffer
+  while (Serial.available() == 0); //Wait for a character
+
+  byte choice = Serial.read();
+
+  if (choice == 's')
+  {
+    Serial.print(F("Staging image in slot "));
+    Serial.println(mySlots.getInactiveSlot() == SFE_FLASH_SLOT_A ? F("A") : F("B"));
+
+    unsigned long startTime = millis();
+
+    if (mySlots.beginImage(IMAGE_SIZE) == false)
+    {
+      Serial.println(F("beginImage failed"));
+      return;
+    }
+
+    uint8_t chunk[100]; // Pretend this arrived over the air
+    for (uint32_t x = 0 ; x < IMAGE_SIZE ; x += sizeof(chunk))
+    {
+      for (uint8_t y = 0 ; y < sizeof(chunk) ; y++)
+        chunk[y] = x + y;
+
+      uint16_t chunkSize = sizeof(chunk);
+      if (chunkSize > (IMAGE_SIZE - x))
+        chunkSize = IMAGE_SIZE - x;
+
+      if (mySlots.writeImage(chunk, chunkSize) == false)
+      {
+        Serial.println(F("writeImage failed"));
+        return;
+      }
+    }
+
+    if (mySlots.finishImage() == false)
+    {
+      Serial.println(F("Image did not read back correctly"));
+      return;
+    }
+
+    Serial.print(F("Staged in "));
+    Serial.print(millis() - startTime);
+    Serial.print(F("ms. CRC32: 0x"));
+    Serial.println(mySlots.getStagedCRC(), HEX);
+
+    if (mySlots.commit() == true)
+      Serial.println(F("Committed"));
+    else
+      Serial.println(F("Commit failed"));
+
+    printSlots();
+  }
+  else if (choice == 'c')
+  {
+    if (mySlots.confirm() == true)
+      Serial.println(F("Confirmed"));
+    else
+      Serial.println(F("Confirm failed"));
+    printSlots();
+  }
+  else if (choice == 'r')
+  {
+    if (mySlots.rollback() == true)
+      Serial.println(F("Rolled back"));
+    else
+      Serial.println(F("Rollback failed. Is there a good image in the other slot?"));
+    printSlots();
+  }
+  else
+  {
+    Serial.print("Unknown choice: ");
+    Serial.write(choice);
+    Serial.println();
+  }
+}
+
+void printSlots()
+{
+  Serial.print(F("Active slot: "));
+  if (mySlots.getActiveSlot() == SFE_FLASH_SLOT_NONE)
+    Serial.println(F("none"));
+  else
+  {
+    Serial.print(mySlots.getActiveSlot() == SFE_FLASH_SLOT_A ? F("A") : F("B"));
+    Serial.println(mySlots.isPending() ? F(" (pending)") : F(" (confirmed)"));
+  }
+
+  Serial.print(F("Slot A: "));
+  Serial.print(mySlots.getImageSize(SFE_FLASH_SLOT_A));
+  Serial.print(F(" bytes. Slot B: "));
+  Serial.print(mySlots.getImageSize(SFE_FLASH_SLOT_B));
+  Serial.println(F(" bytes"));
+}
@@ -0,0 +1,87 @@
+/*
+  Created: October 18, 2026
+  License: Lemonadeware. Buy me a lemonade (or other) someday.
+
+  This sketch measures read, program and erase speed, then finds the fastest
+  reliable SPI clock for your board and flash, and measures again.
+
+  WARNING: the 4KB sector at SCRATCH_ADDRESS is erased!
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17115
+*/
+
+const byte PIN_FLASH_CS = 8; // Change this to match the Chip Select pin on your board
+
+const uint32_t SCRATCH_ADDRESS = 0x000000; // Change this to a sector you don't mind losing
+const uint32_t MAX_SPI_SPEED = 50000000; // Don't go faster than this. Check the flash datasheet (fR for the Read Data command)
+
+#include <SPI.h>
+
+#include <SparkFun_SPI_SerialFlash.h> //Click here to get the library: http://librarymanager/All#SparkFun_SPI_SerialFlash
+SFE_SPI_FLASH myFlash;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun SPI SerialFlash Benchmark Example"));
+
+  //myFlash.enableDebugging(); // Uncomment this line to see each clock tuning step
+
+  // Start slowly. tuneClock works up from here
+  if (myFlash.begin(PIN_FLASH_CS, 1000000) == false)
+  {
+    Serial.println(F("SPI Flash not detected. Check wiring. Maybe you need to pull up WP/IO2 and HOLD/IO3? Freezing..."));
+    while (1);
+  }
+
+  Serial.print(F("Manufacturer: "));
+  Serial.println(myFlash.manufacturerIDString(myFlash.getManufacturerID()));
+  Serial.print(F("Device ID: 0x"));
+  Serial.println(myFlash.getDeviceID(), HEX);
+
+  runBenchmark();
+
+  Serial.println();
+  Serial.println(F("Tuning the SPI clock..."));
+  uint32_t newSpeed = myFlash.tuneClock(SCRATCH_ADDRESS, MAX_SPI_SPEED);
+  if (newSpeed == 0)
+  {
+    Serial.println(F("Clock tuning failed. Is the scratch sector write protected?"));
+    return;
+  }
+
+  runBenchmark();
+}
+
+void loop()
+{
+  // Nothing to do
+}
+
+void runBenchmark()
+{
+  sfe_flash_benchmark_t results;
+  if (myFlash.benchmark(SCRATCH_ADDRESS, &results) == false)
+  {
+    Serial.println(F("Benchmark failed"));
+    return;
+  }
+
+  Serial.println();
+  Serial.print(F("SPI clock (Hz):            "));
+  Serial.println(results.spiSpeed);
+  Serial.print(F("Read rate (bytes/s):       "));
+  Serial.println(results.readRate);
+  Serial.print(F("Program rate (bytes/s):    "));
+  Serial.println(results.programRate);
+  Serial.print(F("Erase rate (bytes/s):      "));
+  Serial.println(results.eraseRate);
+  Serial.print(F("readByte latency (us):     "));
+  Serial.println(results.readLatency);
+  Serial.print(F("Page program latency (us): "));
+  Serial.println(results.programLatency);
+  Serial.print(F("Sector erase latency (us): "));
+  Serial.println(results.eraseLatency);
+}
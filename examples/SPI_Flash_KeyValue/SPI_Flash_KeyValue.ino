@@ -0,0 +1,74 @@
+/*
+  Created: October 18, 2026
+  License: Lemonadeware. Buy me a lemonade (or other) someday.
+
+  This sketch demonstrates how to keep configuration values in SPI flash using the key-value store.
+
+  Each set appends a record, so nothing is erased until the store needs compacting.
+  Each get is a single read, using an index which is rebuilt in RAM when the store is mounted.
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17115
+*/
+
+const byte PIN_FLASH_CS = 8; // Change this to match the Chip Select pin on your board
+
+#include <SPI.h>
+
+#include <SparkFun_SPI_SerialFlash.h> //Click here to get the library: http://librarymanager/All#SparkFun_SPI_SerialFlash
+#include <SparkFun_SPI_SerialFlash_KV.h>
+SFE_SPI_FLASH myFlash;
+SFE_SPI_FLASH_KV myConfig;
+
+const uint32_t CONFIG_BASE_ADDRESS = 0x200000; // Must be a multiple of SFE_FLASH_SECTOR_SIZE
+const uint16_t CONFIG_SECTORS = 4; // 4 x 4KB sectors. One is always kept free for compaction
+const uint16_t CONFIG_INDEX_SIZE = 64; // RAM index entries. A power of two, comfortably more than the number of keys
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("SparkFun SPI SerialFlash Key-Value Example"));
+
+  if (myFlash.begin(PIN_FLASH_CS) == false)
+  {
+    Serial.println(F("SPI Flash not detected. Check wiring. Maybe you need to pull up WP/IO2 and HOLD/IO3? Freezing..."));
+    while (1);
+  }
+
+  if (myConfig.begin(myFlash, CONFIG_BASE_ADDRESS, CONFIG_SECTORS, CONFIG_INDEX_SIZE) == false)
+  {
+    Serial.println(F("Could not mount the key-value store. Freezing..."));
+    while (1);
+  }
+
+  Serial.print(F("Keys stored: "));
+  Serial.println(myConfig.getKeyCount());
+
+  // Count how many times we have started
+  uint32_t bootCount = 0;
+  if (myConfig.get("bootCount", (uint8_t *)&bootCount, sizeof(bootCount)) == false)
+    Serial.println(F("bootCount not found. Starting from zero"));
+  bootCount++;
+  myConfig.set("bootCount", (uint8_t *)&bootCount, sizeof(bootCount));
+
+  Serial.print(F("Boot count: "));
+  Serial.println(bootCount);
+
+  // Store a string, including its NULL
+  const char name[] = "SparkFun";
+  myConfig.set("deviceName", (const uint8_t *)name, sizeof(name));
+
+  char readName[20];
+  uint16_t nameSize;
+  if (myConfig.get("deviceName", (uint8_t *)readName, sizeof(readName), &nameSize) == true)
+  {
+    Serial.print(F("Device name: "));
+    Serial.println(readName);
+  }
+}
+
+void loop()
+{
+  // Nothing to do
+}
@@ -57,6 +57,11 @@ bool SFE_SPI_FLASH::begin(uint8_t user_CSPin, uint32_t spiPortSpeed, SPIClass &s
 
   _spiPort->begin(); //Turn on SPI hardware
 
+  //The flash could have been left in deep power-down, e.g. by a processor reset. Release it before we talk to it
+  _poweredDown = true;
+  wakeUp();
+  resetPowerCounters();
+
   return (isConnected()); //Check that the flash is responding correctly
 }
 
@@ -140,9 +145,15 @@ bool SFE_SPI_FLASH::isConnected()
 //Send command to do a full erase of the entire flash space
 sfe_flash_read_write_result_e SFE_SPI_FLASH::erase()
 {
-  if (blockingBusyWait(1000) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  lockBus(); //Hold the bus while we start the erase. It is released while we wait for the erase to complete
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  if (blockingBusyWaitNoLock(1000) == false) //Wait for device to complete previous actions
+  {
+    unlockBus();
+    return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY);
+  }
+
+  beginSPI();
 
   //Write enable
   /*
@@ -158,7 +169,9 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::erase()
   _spiPort->transfer(SFE_FLASH_COMMAND_CHIP_ERASE); //Do entire chip erase
   digitalWrite(_PIN_FLASH_CS, HIGH);
 
-  _spiPort->endTransaction();
+  endSPI();
+
+  unlockBus();
 
   if (_printDebug == true)
   {
@@ -191,7 +204,15 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::erase()
 //Reads a byte from a given location
 uint8_t SFE_SPI_FLASH::readByte(uint32_t address, sfe_flash_read_write_result_e *result)
 {
-  if (blockingBusyWait(100) == false) //Wait for device to complete previous actions
+  busLock lock(this); //Hold the bus until we return
+
+  return (readByteNoLock(address, result));
+}
+
+//Reads a byte from a given location. The caller must hold the bus lock
+uint8_t SFE_SPI_FLASH::readByteNoLock(uint32_t address, sfe_flash_read_write_result_e *result)
+{
+  if (blockingBusyWaitNoLock(100) == false) //Wait for device to complete previous actions
   {
     if (result != NULL)
     {
@@ -200,7 +221,7 @@ uint8_t SFE_SPI_FLASH::readByte(uint32_t address, sfe_flash_read_write_result_e
     return (0xBB); // Return booboo (because we have to return something...)
   }
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  beginSPI();
   //Begin reading
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_READ_DATA); //Read command, no dummy bytes
@@ -209,7 +230,7 @@ uint8_t SFE_SPI_FLASH::readByte(uint32_t address, sfe_flash_read_write_result_e
   _spiPort->transfer(address & 0xFF); //Address byte LSB
   uint8_t response = _spiPort->transfer(0xFF); //Read in a byte back from flash
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
 
   if (result != NULL)
   {
@@ -221,13 +242,21 @@ uint8_t SFE_SPI_FLASH::readByte(uint32_t address, sfe_flash_read_write_result_e
 
 //Reads a block of bytes into a given array, from a given location
 sfe_flash_read_write_result_e SFE_SPI_FLASH::readBlock(uint32_t address, uint8_t * dataArray, uint16_t dataSize)
+{
+  busLock lock(this); //Hold the bus until we return
+
+  return (readBlockNoLock(address, dataArray, dataSize));
+}
+
+//Reads a block of bytes into a given array, from a given location. The caller must hold the bus lock
+sfe_flash_read_write_result_e SFE_SPI_FLASH::readBlockNoLock(uint32_t address, uint8_t * dataArray, uint16_t dataSize)
 {
   if (dataSize == 0) // Bail if dataSize is zero
     return(SFE_FLASH_READ_WRITE_ZERO_SIZE);
 
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  beginSPI();
   //Begin reading
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_READ_DATA); //Read command, no dummy bytes
@@ -237,7 +266,7 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::readBlock(uint32_t address, uint8_t
   for (uint16_t x = 0 ; x < dataSize ; x++)
     dataArray[x] = _spiPort->transfer(0xFF);
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
@@ -245,9 +274,17 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::readBlock(uint32_t address, uint8_t
 //Writes a byte to a specific location
 sfe_flash_read_write_result_e SFE_SPI_FLASH::writeByte(uint32_t address, uint8_t thingToWrite)
 {
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  busLock lock(this); //Hold the bus until we return
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  return (writeByteNoLock(address, thingToWrite));
+}
+
+//Writes a byte to a specific location. The caller must hold the bus lock
+sfe_flash_read_write_result_e SFE_SPI_FLASH::writeByteNoLock(uint32_t address, uint8_t thingToWrite)
+{
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+
+  beginSPI();
 
   //Write enable
   /*
@@ -267,20 +304,28 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::writeByte(uint32_t address, uint8_t
   _spiPort->transfer(thingToWrite); //Data!
   digitalWrite(_PIN_FLASH_CS, HIGH);
 
-  _spiPort->endTransaction();
+  endSPI();
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
 
 //Write bytes to a specific location
 sfe_flash_read_write_result_e SFE_SPI_FLASH::writeBlock(uint32_t address, uint8_t *dataArray, uint16_t dataSize)
+{
+  busLock lock(this); //Hold the bus until we return
+
+  return (writeBlockNoLock(address, dataArray, dataSize));
+}
+
+//Write bytes to a specific location. The caller must hold the bus lock
+sfe_flash_read_write_result_e SFE_SPI_FLASH::writeBlockNoLock(uint32_t address, uint8_t *dataArray, uint16_t dataSize)
 {
   if (dataSize == 0) // Bail if dataSize is zero
     return(SFE_FLASH_READ_WRITE_ZERO_SIZE);
 
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  beginSPI();
 
   //Write enable
   /*
@@ -302,24 +347,277 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::writeBlock(uint32_t address, uint8_
     _spiPort->transfer(dataArray[x]); //Data!
 
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
+
+  return(SFE_FLASH_READ_WRITE_SUCCESS);
+}
+
+//Reads consecutive bytes into several arrays using a single read command
+//The segments are filled in order, starting at address. This avoids a separate command/address cycle per array.
+sfe_flash_read_write_result_e SFE_SPI_FLASH::readv(uint32_t address, const sfe_flash_segment_t *segments, uint8_t numSegments)
+{
+  uint32_t totalSize = 0;
+  for (uint8_t s = 0 ; s < numSegments ; s++)
+    totalSize += segments[s].size;
+
+  if (totalSize == 0) // Bail if there is nothing to read
+    return(SFE_FLASH_READ_WRITE_ZERO_SIZE);
+
+  busLock lock(this); //Hold the bus until we return
+
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+
+  beginSPI();
+  //Begin reading
+  digitalWrite(_PIN_FLASH_CS, LOW);
+  _spiPort->transfer(SFE_FLASH_COMMAND_READ_DATA); //Read command, no dummy bytes
+  _spiPort->transfer(address >> 16); //Address byte MSB
+  _spiPort->transfer(address >> 8); //Address byte MMSB
+  _spiPort->transfer(address & 0xFF); //Address byte LSB
+  for (uint8_t s = 0 ; s < numSegments ; s++)
+  {
+    for (uint16_t x = 0 ; x < segments[s].size ; x++)
+      segments[s].data[x] = _spiPort->transfer(0xFF);
+  }
+  digitalWrite(_PIN_FLASH_CS, HIGH);
+  endSPI();
+
+  return(SFE_FLASH_READ_WRITE_SUCCESS);
+}
+
+//Writes several arrays to consecutive locations, starting at address
+//The data is streamed straight from the segments - no staging buffer is needed.
+//Page Program wraps around at the end of a page, so the write is split into one Page Program per page.
+sfe_flash_read_write_result_e SFE_SPI_FLASH::writev(uint32_t address, const sfe_flash_const_segment_t *segments, uint8_t numSegments)
+{
+  uint32_t totalSize = 0;
+  for (uint8_t s = 0 ; s < numSegments ; s++)
+    totalSize += segments[s].size;
+
+  if (totalSize == 0) // Bail if there is nothing to write
+    return(SFE_FLASH_READ_WRITE_ZERO_SIZE);
+
+  uint8_t segment = 0; //The segment we are writing from
+  uint16_t segmentOffset = 0; //The next byte to write from that segment
+
+  while (totalSize > 0)
+  {
+    uint16_t chunkSize = SFE_FLASH_PAGE_SIZE - (address % SFE_FLASH_PAGE_SIZE); //Bytes left in this page
+    if (chunkSize > totalSize)
+      chunkSize = totalSize;
+
+    busLock lock(this); //Hold the bus for this page only, so other tasks can get in between pages
+
+    if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for the previous page to complete
+
+    beginSPI();
+
+    digitalWrite(_PIN_FLASH_CS, LOW);
+    _spiPort->transfer(SFE_FLASH_COMMAND_WRITE_ENABLE); //Sets the WEL bit to 1. Needed before every Page Program
+    digitalWrite(_PIN_FLASH_CS, HIGH);
+
+    digitalWrite(_PIN_FLASH_CS, LOW);
+    _spiPort->transfer(SFE_FLASH_COMMAND_PAGE_PROGRAM); //Byte/Page program
+    _spiPort->transfer(address >> 16); //Address byte MSB
+    _spiPort->transfer(address >> 8); //Address byte MMSB
+    _spiPort->transfer(address & 0xFF); //Address byte LSB
+
+    for (uint16_t x = 0 ; x < chunkSize ; x++)
+    {
+      while (segmentOffset == segments[segment].size) //Move on to the next non-empty segment
+      {
+        segment++;
+        segmentOffset = 0;
+      }
+      _spiPort->transfer(segments[segment].data[segmentOffset++]); //Data!
+    }
+
+    digitalWrite(_PIN_FLASH_CS, HIGH);
+    endSPI();
+
+    address += chunkSize;
+    totalSize -= chunkSize;
+  }
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
 
+//Erase the 4KB sector containing address
+//Like the writes, this does not wait for the erase to complete. Sector erase can take up to 400ms,
+//so the next call waits up to 1000ms (instead of the usual 100ms) for it to finish
+sfe_flash_read_write_result_e SFE_SPI_FLASH::eraseSector(uint32_t address)
+{
+  busLock lock(this); //Hold the bus until we return
+
+  return (eraseSectorNoLock(address));
+}
+
+//Erase the 4KB sector containing address. The caller must hold the bus lock
+sfe_flash_read_write_result_e SFE_SPI_FLASH::eraseSectorNoLock(uint32_t address)
+{
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+
+  beginSPI();
+
+  digitalWrite(_PIN_FLASH_CS, LOW);
+  _spiPort->transfer(SFE_FLASH_COMMAND_WRITE_ENABLE); //Sets the WEL bit to 1
+  digitalWrite(_PIN_FLASH_CS, HIGH);
+
+  digitalWrite(_PIN_FLASH_CS, LOW);
+  _spiPort->transfer(SFE_FLASH_COMMAND_SECTOR_ERASE); //Sector erase
+  _spiPort->transfer(address >> 16); //Address byte MSB
+  _spiPort->transfer(address >> 8); //Address byte MMSB
+  _spiPort->transfer(address & 0xFF); //Address byte LSB
+  digitalWrite(_PIN_FLASH_CS, HIGH);
+
+  endSPI();
+
+  _erasePending = true; //Make the next call wait long enough
+
+  return(SFE_FLASH_READ_WRITE_SUCCESS);
+}
+
+//Run a list of reads, programs and sector erases in a single transaction
+//The operations run in the order given. The busy flag is only polled when the previous program or erase
+//could still be running, so a run of reads costs no polling at all.
+//Each operation's result is written to its result field. If an operation fails, the remaining operations are skipped.
+//Returns SFE_FLASH_READ_WRITE_SUCCESS if every operation succeeded, otherwise the first failure.
+sfe_flash_read_write_result_e SFE_SPI_FLASH::executeBatch(sfe_flash_batch_t *batch, uint8_t numOps)
+{
+  if (numOps == 0) // Bail if there is nothing to do
+    return(SFE_FLASH_READ_WRITE_ZERO_SIZE);
+
+  busLock lock(this); //Hold the bus for the whole batch
+
+  sfe_flash_read_write_result_e overallResult = SFE_FLASH_READ_WRITE_SUCCESS;
+  bool mayBeBusy = true; //We don't know what the flash was doing before the batch
+  uint16_t maxWait = (_erasePending == true) ? 1000 : 100; //How long to wait for the previous operation
+
+  beginSPI();
+
+  for (uint8_t op = 0 ; op < numOps ; op++)
+  {
+    sfe_flash_batch_t *thisOp = &batch[op];
+
+    if (overallResult != SFE_FLASH_READ_WRITE_SUCCESS)
+    {
+      thisOp->result = SFE_FLASH_READ_WRITE_SKIPPED;
+      continue;
+    }
+
+    if ((thisOp->op != SFE_FLASH_BATCH_ERASE_SECTOR) && (thisOp->size == 0))
+    {
+      thisOp->result = SFE_FLASH_READ_WRITE_ZERO_SIZE; //Nothing to do, but not a failure
+      continue;
+    }
+
+    if (mayBeBusy == true)
+    {
+      if (waitWhileBusyInTransaction(maxWait) == false)
+      {
+        thisOp->result = SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY;
+        overallResult = SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY;
+        continue;
+      }
+      mayBeBusy = false;
+      _erasePending = false;
+    }
+
+    thisOp->result = SFE_FLASH_READ_WRITE_SUCCESS;
+
+    if (thisOp->op == SFE_FLASH_BATCH_READ)
+    {
+      digitalWrite(_PIN_FLASH_CS, LOW);
+      _spiPort->transfer(SFE_FLASH_COMMAND_READ_DATA); //Read command, no dummy bytes
+      _spiPort->transfer(thisOp->address >> 16); //Address byte MSB
+      _spiPort->transfer(thisOp->address >> 8); //Address byte MMSB
+      _spiPort->transfer(thisOp->address & 0xFF); //Address byte LSB
+      for (uint16_t x = 0 ; x < thisOp->size ; x++)
+        thisOp->data[x] = _spiPort->transfer(0xFF);
+      digitalWrite(_PIN_FLASH_CS, HIGH);
+    }
+    else if (thisOp->op == SFE_FLASH_BATCH_PROGRAM)
+    {
+      uint32_t address = thisOp->address;
+      uint16_t offset = 0;
+      while (offset < thisOp->size)
+      {
+        uint16_t chunkSize = SFE_FLASH_PAGE_SIZE - (address % SFE_FLASH_PAGE_SIZE); //Bytes left in this page
+        if (chunkSize > (thisOp->size - offset))
+          chunkSize = thisOp->size - offset;
+
+        if ((offset > 0) && (waitWhileBusyInTransaction(100) == false)) //Wait for the previous page to complete
+        {
+          thisOp->result = SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY;
+          overallResult = SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY;
+          break;
+        }
+
+        digitalWrite(_PIN_FLASH_CS, LOW);
+        _spiPort->transfer(SFE_FLASH_COMMAND_WRITE_ENABLE); //Sets the WEL bit to 1. Needed before every Page Program
+        digitalWrite(_PIN_FLASH_CS, HIGH);
+
+        digitalWrite(_PIN_FLASH_CS, LOW);
+        _spiPort->transfer(SFE_FLASH_COMMAND_PAGE_PROGRAM); //Byte/Page program
+        _spiPort->transfer(address >> 16); //Address byte MSB
+        _spiPort->transfer(address >> 8); //Address byte MMSB
+        _spiPort->transfer(address & 0xFF); //Address byte LSB
+        for (uint16_t x = 0 ; x < chunkSize ; x++)
+          _spiPort->transfer(thisOp->data[offset + x]); //Data!
+        digitalWrite(_PIN_FLASH_CS, HIGH);
+
+        address += chunkSize;
+        offset += chunkSize;
+      }
+      mayBeBusy = true;
+      maxWait = 100;
+    }
+    else //if (thisOp->op == SFE_FLASH_BATCH_ERASE_SECTOR)
+    {
+      digitalWrite(_PIN_FLASH_CS, LOW);
+      _spiPort->transfer(SFE_FLASH_COMMAND_WRITE_ENABLE); //Sets the WEL bit to 1
+      digitalWrite(_PIN_FLASH_CS, HIGH);
+
+      digitalWrite(_PIN_FLASH_CS, LOW);
+      _spiPort->transfer(SFE_FLASH_COMMAND_SECTOR_ERASE); //Sector erase
+      _spiPort->transfer(thisOp->address >> 16); //Address byte MSB
+      _spiPort->transfer(thisOp->address >> 8); //Address byte MMSB
+      _spiPort->transfer(thisOp->address & 0xFF); //Address byte LSB
+      digitalWrite(_PIN_FLASH_CS, HIGH);
+
+      mayBeBusy = true;
+      maxWait = 1000; //Sector erase can take up to 400ms
+    }
+  }
+
+  endSPI();
+
+  _erasePending = ((mayBeBusy == true) && (maxWait > 100)); //Did the batch end with a sector erase?
+
+  if (_printDebug == true)
+  {
+    _debugSerial->print(F("SFE_SPI_FLASH::executeBatch: Result: "));
+    _debugSerial->println(overallResult);
+  }
+
+  return (overallResult);
+}
+
 //Write bytes to a specific location using Auto Address Increment
 //This is how multiple bytes are written to (e.g.) the Microchip SST25VF020B
 sfe_flash_read_write_result_e SFE_SPI_FLASH::writeBlockAAI(uint32_t address, uint8_t *dataArray, uint16_t dataSize)
 {
+  busLock lock(this); //Hold the bus until we return
+
   if (dataSize == 0) // Bail if dataSize is zero
     return(SFE_FLASH_READ_WRITE_ZERO_SIZE);
 
   if (dataSize == 1) // AAI can only write byte pairs. If dataSize is 1, just do a writeByte
-    return(writeByte(address, dataArray[0]));
+    return(writeByteNoLock(address, dataArray[0]));
 
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  beginSPI();
 
   //DBSY: Disable SO as RY/BY# Status during AAI Programming. We will poll the busy flag instead.
   digitalWrite(_PIN_FLASH_CS, LOW);
@@ -362,74 +660,159 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::writeBlockAAI(uint32_t address, uin
   _spiPort->transfer(SFE_FLASH_COMMAND_WRITE_DISABLE);
   digitalWrite(_PIN_FLASH_CS, HIGH);
 
-  _spiPort->endTransaction();
+  endSPI();
 
   //Check if we still have a single byte to write
   if (x == (dataSize - 1))
-    return(writeByte(address + dataSize - 1, dataArray[dataSize - 1]));
+    return(writeByteNoLock(address + dataSize - 1, dataArray[dataSize - 1]));
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
 
 //Returns true if the device Busy bit is set
-//Of course busy logic is different between 25XX vs 45XX and reverse of each other
 bool SFE_SPI_FLASH::isBusy()
+{
+  busLock lock(this); //Hold the bus until we return
+
+  return (isBusyNoLock());
+}
+
+//Returns true if the device Busy bit is set. The caller must hold the bus lock
+//Of course busy logic is different between 25XX vs 45XX and reverse of each other
+bool SFE_SPI_FLASH::isBusyNoLock()
 {
   if (_flashFamily == SFE_FLASH_FAMILY_25XX)
   {
     //Busy bit is bit 0 of status register 1
-    uint8_t status = getStatus1();
+    uint8_t status = getStatus1NoLock();
     if (status & (1 << 0)) return (true); //1 = device is busy
     return (false);
   }
   else //if (_flashFamily == SFE_FLASH_FAMILY_45XX)
   {
     //Busy bit is bit 7 of byte 2
-    uint16_t status = getStatus16();
+    uint16_t status = getStatus16NoLock();
     if (status & (1 << 15)) return (false); //0 = device is busy
     return (true);
   }
 }
 
 //Wait for busy flag to clear
+//The bus lock is only held while the status is read, so other tasks can use the bus in between
+//If a sector erase was started, wait at least 1000ms: it can take up to 400ms
 bool SFE_SPI_FLASH::blockingBusyWait(uint16_t maxWait)
 {
   //Wait for device to complete previous actions
-  while (isBusy() == true)
+  while (true)
   {
+    {
+      busLock lock(this); //Hold the bus while we read the status and update _erasePending
+
+      if ((_erasePending == true) && (maxWait < 1000))
+        maxWait = 1000;
+
+      if (isBusyNoLock() == false)
+      {
+        _erasePending = false;
+        return (true);
+      }
+    }
+
     if (maxWait-- == 0) return (false);
     delay(1);
   }
+}
+
+//Wait for busy flag to clear. The caller must hold the bus lock
+//If a sector erase was started, wait at least 1000ms: it can take up to 400ms
+bool SFE_SPI_FLASH::blockingBusyWaitNoLock(uint16_t maxWait)
+{
+  if ((_erasePending == true) && (maxWait < 1000))
+    maxWait = 1000;
+
+  //Wait for device to complete previous actions
+  while (isBusyNoLock() == true)
+  {
+    if (maxWait-- == 0) return (false);
+    delay(1);
+  }
+  _erasePending = false;
   return (true);
 }
 
 
+//Poll the busy flag inside an existing transaction. Returns false if the flash is still busy after maxWait ms
+//The status register is output continuously while CS is low, so we only need to send the command once
+bool SFE_SPI_FLASH::waitWhileBusyInTransaction(uint16_t maxWait)
+{
+  bool busy;
+  unsigned long startTime = millis();
+
+  digitalWrite(_PIN_FLASH_CS, LOW);
+  if (_flashFamily == SFE_FLASH_FAMILY_25XX)
+  {
+    _spiPort->transfer(SFE_FLASH_COMMAND_READ_STATUS_25XX); //Read status byte 1
+    do
+    {
+      busy = ((_spiPort->transfer(0xFF) & (1 << 0)) != 0); //Busy bit is bit 0. 1 = device is busy
+    } while ((busy == true) && ((millis() - startTime) < maxWait));
+  }
+  else //if (_flashFamily == SFE_FLASH_FAMILY_45XX)
+  {
+    _spiPort->transfer(SFE_FLASH_COMMAND_READ_STATUS_45XX); //Read status bytes
+    do
+    {
+      busy = ((_spiPort->transfer(0xFF) & (1 << 7)) == 0); //Busy bit is bit 7 of byte 1. 0 = device is busy
+      _spiPort->transfer(0xFF); //Skip byte 2
+    } while ((busy == true) && ((millis() - startTime) < maxWait));
+  }
+  digitalWrite(_PIN_FLASH_CS, HIGH);
+
+  return (busy == false);
+}
+
 //Returns status byte 0 in 25xx types of flash. Useful for BUSY testing.
 uint8_t SFE_SPI_FLASH::getStatus1()
 {
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  busLock lock(this); //Hold the bus until we return
+
+  return (getStatus1NoLock());
+}
+
+//Returns status byte 0 in 25xx types of flash. The caller must hold the bus lock
+uint8_t SFE_SPI_FLASH::getStatus1NoLock()
+{
+  beginSPI();
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_READ_STATUS_25XX); //Read status byte 1
   uint8_t response = _spiPort->transfer(0xFF); //Get byte 1
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
 
   return (response);
 }
 
 //Returns the two status bytes found in 45xx types of flash.
 uint16_t SFE_SPI_FLASH::getStatus16()
+{
+  busLock lock(this); //Hold the bus until we return
+
+  return (getStatus16NoLock());
+}
+
+//Returns the two status bytes found in 45xx types of flash. The caller must hold the bus lock
+uint16_t SFE_SPI_FLASH::getStatus16NoLock()
 {
   uint16_t response = 0;
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  beginSPI();
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_READ_STATUS_45XX); //Read status bytes
   response |= _spiPort->transfer(0xFF); //Get byte 1
   response <<= 8;
   response |= _spiPort->transfer(0xFF); //Get byte 2
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
 
   return (response);
 }
@@ -437,9 +820,11 @@ uint16_t SFE_SPI_FLASH::getStatus16()
 //Set the write status register in 25xx types of flash. Useful for clearing the Block Protetction bits
 sfe_flash_read_write_result_e SFE_SPI_FLASH::setWriteStatusReg1(uint8_t statusByte)
 {
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  busLock lock(this); //Hold the bus until we return
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+
+  beginSPI();
 
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_ENABLE_WRITE_STATUS_REG); //Enable status register writing
@@ -450,7 +835,7 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::setWriteStatusReg1(uint8_t statusBy
   _spiPort->transfer(statusByte);
   digitalWrite(_PIN_FLASH_CS, HIGH);
 
-  _spiPort->endTransaction();
+  endSPI();
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
@@ -458,9 +843,11 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::setWriteStatusReg1(uint8_t statusBy
 //Set the write status registers in 25xx types of flash. Useful for clearing the Block Protetction bits
 sfe_flash_read_write_result_e SFE_SPI_FLASH::setWriteStatusReg16(uint16_t statusWord)
 {
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  busLock lock(this); //Hold the bus until we return
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+
+  beginSPI();
 
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_ENABLE_WRITE_STATUS_REG); //Enable status register writing
@@ -472,21 +859,29 @@ sfe_flash_read_write_result_e SFE_SPI_FLASH::setWriteStatusReg16(uint16_t status
   _spiPort->transfer(statusWord & 0xFF);
   digitalWrite(_PIN_FLASH_CS, HIGH);
 
-  _spiPort->endTransaction();
+  endSPI();
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
 
 //Returns the three Manufacturer ID and Device ID bytes
 uint32_t SFE_SPI_FLASH::getJEDEC()
+{
+  busLock lock(this); //Hold the bus until we return
+
+  return (getJEDECNoLock());
+}
+
+//Returns the three Manufacturer ID and Device ID bytes. The caller must hold the bus lock
+uint32_t SFE_SPI_FLASH::getJEDECNoLock()
 {
   uint32_t jedecID = 0;
 
   //Begin reading 3 JEDEC bytes:
   //MF7-0, ID15-8, ID7-0
   //MfgID, Device ID Part 1, Device ID Part2
-  
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+
+  beginSPI();
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_READ_JEDEC_ID); //Read manufacturer and device ID
   for (uint8_t x = 0 ; x < 3 ; x++)
@@ -495,7 +890,7 @@ uint32_t SFE_SPI_FLASH::getJEDEC()
     jedecID |= _spiPort->transfer(0xFF); //Manufacturer ID, then Device ID byte 1, then Device ID byte 2
   }
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
 
   return (jedecID);
 }
@@ -623,18 +1018,392 @@ Program, Sector Erase, Block Erase, Chip Erase and Reset instructions.
 */
 sfe_flash_read_write_result_e SFE_SPI_FLASH::disableWrite()
 {
-  if (blockingBusyWait(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+  busLock lock(this); //Hold the bus until we return
 
-  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Wait for device to complete previous actions
+
+  beginSPI();
   //Write disable
   digitalWrite(_PIN_FLASH_CS, LOW);
   _spiPort->transfer(SFE_FLASH_COMMAND_WRITE_DISABLE); //Sets the WEL bit to 0
   digitalWrite(_PIN_FLASH_CS, HIGH);
-  _spiPort->endTransaction();
+  endSPI();
+
+  return(SFE_FLASH_READ_WRITE_SUCCESS);
+}
+
+//Put the flash into Deep Power-Down to save power. Any read, write or erase will wake it again automatically
+sfe_flash_read_write_result_e SFE_SPI_FLASH::powerDown()
+{
+  busLock lock(this); //Hold the bus until we return
+
+  if (_poweredDown == true) return (SFE_FLASH_READ_WRITE_SUCCESS); //Nothing to do
+
+  if (blockingBusyWaitNoLock(100) == false) return (SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY); //Deep Power-Down is ignored during program and erase
+
+  beginSPI();
+  digitalWrite(_PIN_FLASH_CS, LOW);
+  _spiPort->transfer(SFE_FLASH_COMMAND_DEEP_POWER_DOWN); //All commands except Release Power-Down are ignored from now on
+  digitalWrite(_PIN_FLASH_CS, HIGH);
+  endSPI();
+
+  updatePowerCounters();
+  _poweredDown = true;
+
+  if (_printDebug == true)
+  {
+    _debugSerial->println(F("SFE_SPI_FLASH::powerDown: Entered deep power-down"));
+  }
+
+  return(SFE_FLASH_READ_WRITE_SUCCESS);
+}
+
+//Release the flash from Deep Power-Down. You only need to call this if you want to control when the wake-up delay happens
+sfe_flash_read_write_result_e SFE_SPI_FLASH::wakeUp()
+{
+  busLock lock(this); //Hold the bus until we return
+
+  if (_poweredDown == true)
+  {
+    beginSPI(); //beginSPI does the actual release
+    endSPI();
+  }
 
   return(SFE_FLASH_READ_WRITE_SUCCESS);
 }
 
+//Returns true if the flash has been put into Deep Power-Down
+bool SFE_SPI_FLASH::isPoweredDown()
+{
+  return (_poweredDown);
+}
+
+//Put the flash into Deep Power-Down automatically after idleTimeout milliseconds without access. 0 disables
+void SFE_SPI_FLASH::setIdlePowerDown(uint32_t idleTimeout)
+{
+  _idleTimeout = idleTimeout;
+}
+
+//Set the time needed to release from Deep Power-Down (tRES1) in microseconds. Check your flash datasheet
+void SFE_SPI_FLASH::setWakeDelay(uint16_t wakeDelay)
+{
+  _wakeDelay = wakeDelay;
+}
+
+//Call this regularly (e.g. from loop or an idle task). Enters Deep Power-Down once the idle timeout has expired
+//Returns true if the flash is powered down
+bool SFE_SPI_FLASH::checkIdle()
+{
+  if ((_idleTimeout == 0) || (_poweredDown == true))
+    return (_poweredDown);
+
+  if ((millis() - _lastAccess) < _idleTimeout)
+    return (false);
+
+  return (powerDown() == SFE_FLASH_READ_WRITE_SUCCESS);
+}
+
+//Returns the total time in milliseconds that the flash has been awake (standby or active)
+uint32_t SFE_SPI_FLASH::getAwakeTime()
+{
+  if (_poweredDown == true)
+    return (_awakeTime);
+  return (_awakeTime + (millis() - _powerStateChangeTime));
+}
+
+//Returns the total time in milliseconds that the flash has been in Deep Power-Down
+uint32_t SFE_SPI_FLASH::getPowerDownTime()
+{
+  if (_poweredDown == false)
+    return (_powerDownTime);
+  return (_powerDownTime + (millis() - _powerStateChangeTime));
+}
+
+//Returns how many times the flash has been released from Deep Power-Down
+uint32_t SFE_SPI_FLASH::getWakeCount()
+{
+  return (_wakeCount);
+}
+
+//Reset the awake time, power-down time and wake count
+void SFE_SPI_FLASH::resetPowerCounters()
+{
+  _awakeTime = 0;
+  _powerDownTime = 0;
+  _wakeCount = 0;
+  _powerStateChangeTime = millis();
+}
+
+//Add the time since the last power state change to the awake or power-down total
+void SFE_SPI_FLASH::updatePowerCounters()
+{
+  unsigned long now = millis();
+  if (_poweredDown == true)
+    _powerDownTime += now - _powerStateChangeTime;
+  else
+    _awakeTime += now - _powerStateChangeTime;
+  _powerStateChangeTime = now;
+}
+
+//Begin an SPI transaction. Release the flash from Deep Power-Down first if needed
+void SFE_SPI_FLASH::beginSPI()
+{
+  _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, _spiMode));
+
+  if (_poweredDown == true)
+  {
+    digitalWrite(_PIN_FLASH_CS, LOW);
+    _spiPort->transfer(SFE_FLASH_COMMAND_RELEASE_POWER_DOWN);
+    digitalWrite(_PIN_FLASH_CS, HIGH);
+    delayMicroseconds(_wakeDelay); //tRES1: the flash ignores commands until it has woken up
+
+    updatePowerCounters();
+    _poweredDown = false;
+    _wakeCount++;
+  }
+}
+
+//End an SPI transaction and note the time, for the idle power-down
+void SFE_SPI_FLASH::endSPI()
+{
+  _spiPort->endTransaction();
+  _lastAccess = millis();
+}
+
+//Find the fastest reliable SPI clock, up to maxSpeed
+//A test pattern is written to the scratch sector at the current (known good) clock, or maxSpeed if that is lower. The clock is then stepped up,
+//reading the pattern back several times at each step, until a read fails or maxSpeed is reached. Nothing is programmed or erased at an
+//untested clock, as a garbled address could hit user data. If a step failed, we back off one more step for margin, but never below
+//the starting clock. Returns the new clock, or 0 if the pattern could not be written.
+//The bus is held throughout, so nothing else runs at a clock that might not work.
+//This ERASES the 4KB sector at scratchAddress
+uint32_t SFE_SPI_FLASH::tuneClock(uint32_t scratchAddress, uint32_t maxSpeed)
+{
+  //Common SPI clocks. Most processors can only divide their clock down to a few of these
+  const uint32_t speeds[] = { 1000000, 2000000, 4000000, 8000000, 10000000, 12000000, 16000000, 20000000,
+                              24000000, 32000000, 40000000, 48000000, 50000000, 64000000, 80000000, 104000000 };
+  const uint8_t numSpeeds = sizeof(speeds) / sizeof(speeds[0]);
+  const uint8_t passesPerSpeed = 8;
+
+  busLock lock(this); //Hold the bus until we return
+
+  uint32_t callerSpeed = _spiPortSpeed;
+  if (_spiPortSpeed > maxSpeed)
+    _spiPortSpeed = maxSpeed; //Start no faster than we are allowed to finish
+  uint32_t originalSpeed = _spiPortSpeed;
+  uint32_t jedec = getJEDECNoLock();
+  uint8_t pattern[SFE_FLASH_PAGE_SIZE];
+  uint8_t readBack[SFE_FLASH_PAGE_SIZE];
+
+  //Write the pattern at the original clock
+  scratchAddress -= scratchAddress % SFE_FLASH_SECTOR_SIZE;
+  fillTestPattern(pattern, sizeof(pattern));
+  if ((eraseSectorNoLock(scratchAddress) != SFE_FLASH_READ_WRITE_SUCCESS) || (blockingBusyWaitNoLock(1000) == false)
+      || (writeBlockNoLock(scratchAddress, pattern, sizeof(pattern)) != SFE_FLASH_READ_WRITE_SUCCESS) || (blockingBusyWaitNoLock(100) == false)
+      || (readBlockNoLock(scratchAddress, readBack, sizeof(readBack)) != SFE_FLASH_READ_WRITE_SUCCESS)
+      || (memcmp(pattern, readBack, sizeof(pattern)) != 0))
+  {
+    _spiPortSpeed = callerSpeed; //Not even the starting clock works. Leave things as they were
+    return (0);
+  }
+
+  uint32_t previousGoodSpeed = originalSpeed; //The step below the fastest that passed
+  uint32_t bestSpeed = originalSpeed; //The fastest that passed
+  bool failed = false;
+
+  for (uint8_t step = 0 ; step < numSpeeds ; step++)
+  {
+    if ((speeds[step] <= originalSpeed) || (speeds[step] > maxSpeed))
+      continue;
+
+    _spiPortSpeed = speeds[step];
+
+    bool passed = (getJEDECNoLock() == jedec);
+    for (uint8_t pass = 0 ; (pass < passesPerSpeed) && (passed == true) ; pass++)
+    {
+      memset(readBack, 0, sizeof(readBack));
+      passed = ((readBlockNoLock(scratchAddress, readBack, sizeof(readBack)) == SFE_FLASH_READ_WRITE_SUCCESS)
+                && (memcmp(pattern, readBack, sizeof(pattern)) == 0));
+    }
+
+    if (_printDebug == true)
+    {
+      _debugSerial->print(F("SFE_SPI_FLASH::tuneClock: "));
+      _debugSerial->print(speeds[step]);
+      _debugSerial->println(passed ? F("Hz passed") : F("Hz failed"));
+    }
+
+    if (passed == false)
+    {
+      failed = true;
+      break;
+    }
+
+    previousGoodSpeed = bestSpeed;
+    bestSpeed = speeds[step];
+  }
+
+  //If we found the limit, back off one step for margin. previousGoodSpeed is never below the starting clock
+  _spiPortSpeed = (failed == true) ? previousGoodSpeed : bestSpeed;
+
+  if (_printDebug == true)
+  {
+    _debugSerial->print(F("SFE_SPI_FLASH::tuneClock: Using "));
+    _debugSerial->print(_spiPortSpeed);
+    _debugSerial->println(F("Hz"));
+  }
+
+  return (_spiPortSpeed);
+}
+
+//Measure read, program and erase speed at the current clock
+//The bus is held throughout, so other tasks do not skew the timings
+//This ERASES the 4KB sector at scratchAddress
+bool SFE_SPI_FLASH::benchmark(uint32_t scratchAddress, sfe_flash_benchmark_t *results)
+{
+  const uint8_t numReads = 16;
+  uint8_t buffer[SFE_FLASH_PAGE_SIZE];
+  unsigned long startTime;
+  uint32_t elapsed;
+
+  busLock lock(this); //Hold the bus until we return
+
+  scratchAddress -= scratchAddress % SFE_FLASH_SECTOR_SIZE;
+  results->spiSpeed = _spiPortSpeed;
+
+  if (blockingBusyWaitNoLock(1000) == false) //Make sure nothing is still running
+    return (false);
+
+  //Erase
+  startTime = micros();
+  if (eraseSectorNoLock(scratchAddress) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+  if (waitForCompletion(1000000) == false)
+    return (false);
+  elapsed = micros() - startTime;
+  results->eraseLatency = elapsed;
+  results->eraseRate = (uint32_t)(((float)SFE_FLASH_SECTOR_SIZE) * 1000000.0 / (float)(elapsed > 0 ? elapsed : 1));
+
+  //Program every page in the sector
+  fillTestPattern(buffer, sizeof(buffer));
+  startTime = micros();
+  for (uint32_t offset = 0 ; offset < SFE_FLASH_SECTOR_SIZE ; offset += SFE_FLASH_PAGE_SIZE)
+  {
+    if (writeBlockNoLock(scratchAddress + offset, buffer, sizeof(buffer)) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+    if (waitForCompletion(100000) == false)
+      return (false);
+  }
+  elapsed = micros() - startTime;
+  results->programLatency = elapsed / (SFE_FLASH_SECTOR_SIZE / SFE_FLASH_PAGE_SIZE);
+  results->programRate = (uint32_t)(((float)SFE_FLASH_SECTOR_SIZE) * 1000000.0 / (float)(elapsed > 0 ? elapsed : 1));
+
+  //Read the sector back, one page at a time
+  startTime = micros();
+  for (uint32_t offset = 0 ; offset < SFE_FLASH_SECTOR_SIZE ; offset += SFE_FLASH_PAGE_SIZE)
+  {
+    if (readBlockNoLock(scratchAddress + offset, buffer, sizeof(buffer)) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+  }
+  elapsed = micros() - startTime;
+  results->readRate = (uint32_t)(((float)SFE_FLASH_SECTOR_SIZE) * 1000000.0 / (float)(elapsed > 0 ? elapsed : 1));
+
+  //Single byte reads. This is mostly command, address and busy check overhead
+  sfe_flash_read_write_result_e result;
+  startTime = micros();
+  for (uint8_t x = 0 ; x < numReads ; x++)
+  {
+    readByteNoLock(scratchAddress + x, &result);
+    if (result != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+  }
+  results->readLatency = (micros() - startTime) / numReads;
+
+  return (true);
+}
+
+//Change the SPI clock
+void SFE_SPI_FLASH::setSPISpeed(uint32_t spiPortSpeed)
+{
+  busLock lock(this); //Don't change the clock in the middle of someone else's transaction
+
+  _spiPortSpeed = spiPortSpeed;
+}
+
+//Returns the SPI clock
+uint32_t SFE_SPI_FLASH::getSPISpeed()
+{
+  return (_spiPortSpeed);
+}
+
+//Poll the busy flag as fast as possible, for timing. maxWait is in microseconds. The caller must hold the bus lock
+bool SFE_SPI_FLASH::waitForCompletion(uint32_t maxWait)
+{
+  unsigned long startTime = micros();
+  while (isBusyNoLock() == true)
+  {
+    if ((micros() - startTime) > maxWait) return (false);
+  }
+  _erasePending = false;
+  return (true);
+}
+
+//Fill an array with the clock tuning test pattern
+//All zeros, all ones and alternating bits stress the signal edges. The counting part catches shifted bits
+void SFE_SPI_FLASH::fillTestPattern(uint8_t *dataArray, uint16_t dataSize)
+{
+  const uint8_t edges[] = { 0x00, 0xFF, 0xAA, 0x55, 0x0F, 0xF0, 0xCC, 0x33 };
+  for (uint16_t x = 0 ; x < dataSize ; x++)
+  {
+    if (x < (sizeof(edges) * 8))
+      dataArray[x] = edges[x / 8];
+    else
+      dataArray[x] = x;
+  }
+}
+
+//Standard (reflected, 0xEDB88320) CRC32. Pass 0 to start, or the previous result to continue
+//Bitwise rather than table-driven, to save RAM. It is still much quicker than page programming
+uint32_t SFE_SPI_FLASH::crc32(uint32_t crc, const uint8_t *data, uint32_t dataSize)
+{
+  crc = ~crc;
+  for (uint32_t x = 0 ; x < dataSize ; x++)
+  {
+    crc ^= data[x];
+    for (uint8_t bit = 0 ; bit < 8 ; bit++)
+    {
+      if (crc & 1)
+        crc = (crc >> 1) ^ 0xEDB88320;
+      else
+        crc >>= 1;
+    }
+  }
+  return (~crc);
+}
+
+//Share the flash between RTOS tasks. The callbacks are passed context - e.g. the mutex handle
+//Each public method takes the lock once, so it does not need to be a recursive mutex
+void SFE_SPI_FLASH::setLockCallbacks(sfe_flash_lock_callback_t lock, sfe_flash_lock_callback_t unlock, void *context)
+{
+  _lockCallback = lock;
+  _unlockCallback = unlock;
+  _lockContext = context;
+}
+
+//Call the user's lock callback, if there is one
+void SFE_SPI_FLASH::lockBus()
+{
+  if (_lockCallback != NULL)
+    _lockCallback(_lockContext);
+}
+
+//Call the user's unlock callback, if there is one
+void SFE_SPI_FLASH::unlockBus()
+{
+  if (_unlockCallback != NULL)
+    _unlockCallback(_lockContext);
+}
+
 //Enable or disable helpful debug messages
 void SFE_SPI_FLASH::enableDebugging(Stream &debugPort)
 {
@@ -54,11 +54,14 @@ typedef enum
   SFE_FLASH_COMMAND_WRITE_DISABLE = 0x04,           // WRDI
   SFE_FLASH_COMMAND_READ_STATUS_25XX = 0x05,        // RDSR
   SFE_FLASH_COMMAND_WRITE_ENABLE = 0x06,            // WREN
+  SFE_FLASH_COMMAND_SECTOR_ERASE = 0x20,            // SE: 4KB Sector Erase
   SFE_FLASH_COMMAND_ENABLE_WRITE_STATUS_REG = 0x50, // EWSR
   SFE_FLASH_COMMAND_ENABLE_SO_DURING_AAI = 0x70,    // EBSY: Enable SO to Output RY/BY# Status during AAI Programming
   SFE_FLASH_COMMAND_DISABLE_SO_DURING_AAI = 0x80,   // DBSY: Disable SO to Output RY/BY# Status during AAI Programming
   SFE_FLASH_COMMAND_READ_JEDEC_ID = 0x9F,
+  SFE_FLASH_COMMAND_RELEASE_POWER_DOWN = 0xAB,      // RDP: Release from Deep Power-Down
   SFE_FLASH_COMMAND_AAI_WORD_PROGRAM = 0xAD,        // Auto Address Increment Programming
+  SFE_FLASH_COMMAND_DEEP_POWER_DOWN = 0xB9,         // DP
   SFE_FLASH_COMMAND_CHIP_ERASE = 0xC7,
   SFE_FLASH_COMMAND_READ_STATUS_45XX = 0xD7
 } sfe_flash_commands_e;
@@ -89,9 +92,67 @@ typedef enum
 {
   SFE_FLASH_READ_WRITE_FAIL_DEVICE_BUSY = 0,  // Just in case result is cast to boolean
   SFE_FLASH_READ_WRITE_SUCCESS = 1,           // Just in case result is cast to boolean
-  SFE_FLASH_READ_WRITE_ZERO_SIZE              // Return this if dataSize is zero
+  SFE_FLASH_READ_WRITE_ZERO_SIZE,             // Return this if dataSize is zero
+  SFE_FLASH_READ_WRITE_SKIPPED                // Batch operation not run because an earlier operation failed
 } sfe_flash_read_write_result_e;
 
+// Page Program cannot cross a page boundary. 256 bytes suits all of the 25xx devices listed above
+#ifndef SFE_FLASH_PAGE_SIZE
+#define SFE_FLASH_PAGE_SIZE 256
+#endif
+
+// Sector Erase erases this many bytes. 4KB suits all of the 25xx devices listed above
+#ifndef SFE_FLASH_SECTOR_SIZE
+#define SFE_FLASH_SECTOR_SIZE 4096
+#endif
+
+// One segment of a scatter-gather read (see readv)
+typedef struct
+{
+  uint8_t *data;  // Pointer to the RAM buffer for this segment
+  uint16_t size;  // Number of bytes in this segment. Zero-size segments are skipped
+} sfe_flash_segment_t;
+
+// One segment of a scatter-gather write (see writev). The data is only read, so it can be const
+typedef struct
+{
+  const uint8_t *data;  // Pointer to the RAM buffer for this segment
+  uint16_t size;        // Number of bytes in this segment. Zero-size segments are skipped
+} sfe_flash_const_segment_t;
+
+// Batch operation types (see executeBatch)
+typedef enum
+{
+  SFE_FLASH_BATCH_READ,
+  SFE_FLASH_BATCH_PROGRAM,        // Split at page boundaries, like writev
+  SFE_FLASH_BATCH_ERASE_SECTOR    // Erases the 4KB sector containing address
+} sfe_flash_batch_op_e;
+
+// One operation in a batch (see executeBatch)
+typedef struct
+{
+  sfe_flash_batch_op_e op;
+  uint32_t address;
+  uint8_t *data;                          // Read destination or program source. Not used for erase
+  uint16_t size;                          // Bytes to read or program. Not used for erase
+  sfe_flash_read_write_result_e result;   // Filled in by executeBatch
+} sfe_flash_batch_t;
+
+// Results from benchmark. Rates are in bytes per second. Latencies are in microseconds
+typedef struct
+{
+  uint32_t spiSpeed;            // The SPI clock used
+  uint32_t readRate;            // readBlock, one page at a time
+  uint32_t programRate;         // Page Program, including waiting for each page to complete
+  uint32_t eraseRate;           // Sector Erase, including waiting for it to complete
+  uint32_t readLatency;         // Average time for a single readByte
+  uint32_t programLatency;      // Average time to program one page and wait for it to complete
+  uint32_t eraseLatency;        // Time to erase one sector and wait for it to complete
+} sfe_flash_benchmark_t;
+
+// Optional bus lock callbacks. Use these when several RTOS tasks share one SFE_SPI_FLASH (see setLockCallbacks)
+typedef void (*sfe_flash_lock_callback_t)(void *context);
+
 class SFE_SPI_FLASH
 {
 
@@ -105,9 +166,13 @@ class SFE_SPI_FLASH
     sfe_flash_read_write_result_e readBlock(uint32_t address, uint8_t *dataArray, uint16_t dataSize); //Reads a block of bytes into a given array, from a given location
     sfe_flash_read_write_result_e writeByte(uint32_t address, uint8_t thingToWrite); //Writes a byte to a specific location
     sfe_flash_read_write_result_e writeBlock(uint32_t address, uint8_t *dataArray, uint16_t dataSize); //Write bytes to a specific location
+    sfe_flash_read_write_result_e readv(uint32_t address, const sfe_flash_segment_t *segments, uint8_t numSegments); //Reads consecutive bytes into several arrays using a single read command
+    sfe_flash_read_write_result_e writev(uint32_t address, const sfe_flash_const_segment_t *segments, uint8_t numSegments); //Writes several arrays to consecutive locations, split at page boundaries
+    sfe_flash_read_write_result_e eraseSector(uint32_t address); //Erase the 4KB sector containing address
+    sfe_flash_read_write_result_e executeBatch(sfe_flash_batch_t *batch, uint8_t numOps); //Run a list of reads, programs and sector erases in a single transaction
     sfe_flash_read_write_result_e writeBlockAAI(uint32_t address, uint8_t *dataArray, uint16_t dataSize); //Write bytes to a specific location using Auto Address Increment
     bool isBusy(); //Returns true if the device Busy bit is set
-    bool blockingBusyWait(uint16_t maxWait = 100); //Wait for busy flag to clear
+    bool blockingBusyWait(uint16_t maxWait = 100); //Wait for busy flag to clear. Waits at least 1000ms after a sector erase
     uint8_t getStatus1(); //Returns status byte 0 in 25xx types of flash. Useful for BUSY testing.
     uint16_t getStatus16(); //Returns the two status bytes found in 45xx types of flash.
     sfe_flash_read_write_result_e setWriteStatusReg1(uint8_t statusByte); // Writes statusByte to the Status Register
@@ -119,6 +184,36 @@ class SFE_SPI_FLASH
     const char *manufacturerIDString(sfe_flash_manufacturer_e manufacturer); //Pretty-print the manufacturer
     sfe_flash_read_write_result_e disableWrite(); //Disable writing with SFE_FLASH_COMMAND_WRITE_DISABLE
 
+    // Deep Power-Down. Any read, write or erase wakes the flash automatically, waiting tRES1 before the command
+    sfe_flash_read_write_result_e powerDown(); //Put the flash into Deep Power-Down
+    sfe_flash_read_write_result_e wakeUp(); //Release the flash from Deep Power-Down
+    bool isPoweredDown(); //Returns true if the flash is in Deep Power-Down
+    void setIdlePowerDown(uint32_t idleTimeout); //Power down automatically after idleTimeout ms without access (see checkIdle). 0 disables
+    void setWakeDelay(uint16_t wakeDelay); //Set tRES1 in microseconds. Default is 30
+    bool checkIdle(); //Call this regularly. Powers down once the idle timeout has expired. Returns true if powered down
+    uint32_t getAwakeTime(); //Returns the total ms spent awake (standby or active)
+    uint32_t getPowerDownTime(); //Returns the total ms spent in Deep Power-Down
+    uint32_t getWakeCount(); //Returns the number of times the flash has been woken
+    void resetPowerCounters(); //Reset the awake time, power-down time and wake count
+
+    // Clock tuning and benchmarking. Both ERASE the 4KB sector at scratchAddress
+    uint32_t tuneClock(uint32_t scratchAddress, uint32_t maxSpeed = 50000000); //Find the fastest reliable SPI clock, up to maxSpeed. Returns the new clock, or 0 if it failed
+    bool benchmark(uint32_t scratchAddress, sfe_flash_benchmark_t *results); //Measure read, program and erase speed at the current clock
+    void setSPISpeed(uint32_t spiPortSpeed); //Change the SPI clock
+    uint32_t getSPISpeed(); //Returns the SPI clock
+
+    static uint32_t crc32(uint32_t crc, const uint8_t *data, uint32_t dataSize); //Standard CRC32. Pass 0 to start, or the previous result to continue
+
+    // Share the flash between RTOS tasks by providing lock and unlock callbacks.
+    // Each public method takes the lock once, so a plain mutex is fine: e.g. FreeRTOS xSemaphoreCreateMutex,
+    // Zephyr k_mutex, or std::mutex on a host:
+    //   std::mutex flashMutex;
+    //   myFlash.setLockCallbacks([](void *m) { ((std::mutex *)m)->lock(); }, [](void *m) { ((std::mutex *)m)->unlock(); }, &flashMutex);
+    // Long operations only hold the lock while they are using the bus:
+    // erase() releases it while polling, and writev() releases it between pages,
+    // so a higher priority task waiting on the mutex gets the bus between the chunks of a long write.
+    void setLockCallbacks(sfe_flash_lock_callback_t lock, sfe_flash_lock_callback_t unlock, void *context = NULL);
+
     // Enable debug messages using the chosen Serial port (Stream)
     // Boards like the RedBoard Turbo use SerialUSB (not Serial).
     // But other boards like the SAMD51 Thing Plus use Serial (not SerialUSB).
@@ -145,6 +240,52 @@ class SFE_SPI_FLASH
 
   private:
 
+    // Takes the bus lock (if any) on construction and releases it when it goes out of scope
+    class busLock
+    {
+      public:
+        busLock(SFE_SPI_FLASH *flash) : _flash(flash) { _flash->lockBus(); }
+        ~busLock() { _flash->unlockBus(); }
+      private:
+        SFE_SPI_FLASH *_flash;
+    };
+
+    void beginSPI(); //Begin an SPI transaction. Wakes the flash from Deep Power-Down if needed
+    void endSPI(); //End an SPI transaction and note the time of the last access
+    bool waitForCompletion(uint32_t maxWait); //Poll the busy flag as fast as possible, for timing. maxWait is in microseconds
+    void fillTestPattern(uint8_t *dataArray, uint16_t dataSize); //Fill an array with the clock tuning test pattern
+    bool waitWhileBusyInTransaction(uint16_t maxWait); //Poll the busy flag inside an existing transaction
+    void updatePowerCounters(); //Add the time since the last power state change to the correct total
+
+    // These do the bus work without taking the lock. The caller must hold it
+    bool isBusyNoLock();
+    bool blockingBusyWaitNoLock(uint16_t maxWait);
+    uint8_t getStatus1NoLock();
+    uint16_t getStatus16NoLock();
+    sfe_flash_read_write_result_e writeByteNoLock(uint32_t address, uint8_t thingToWrite);
+    uint8_t readByteNoLock(uint32_t address, sfe_flash_read_write_result_e *result);
+    sfe_flash_read_write_result_e readBlockNoLock(uint32_t address, uint8_t *dataArray, uint16_t dataSize);
+    sfe_flash_read_write_result_e writeBlockNoLock(uint32_t address, uint8_t *dataArray, uint16_t dataSize);
+    sfe_flash_read_write_result_e eraseSectorNoLock(uint32_t address);
+    uint32_t getJEDECNoLock();
+
+    void lockBus(); //Call the user's lock callback, if there is one
+    void unlockBus(); //Call the user's unlock callback, if there is one
+
+    sfe_flash_lock_callback_t _lockCallback = NULL;   //Optional user lock callback
+    sfe_flash_lock_callback_t _unlockCallback = NULL; //Optional user unlock callback
+    void *_lockContext = NULL;                        //Passed to the lock and unlock callbacks (e.g. the mutex handle)
+
+    bool _erasePending = false;             //True if a sector erase may still be running. The next call waits longer for it
+    bool _poweredDown = false;              //True when the flash is in Deep Power-Down
+    uint16_t _wakeDelay = 30;               //tRES1 in microseconds. 3us for the W25Q128JV, up to 30us for other parts
+    uint32_t _idleTimeout = 0;              //Power down after this many ms without access. 0 = never
+    unsigned long _lastAccess = 0;          //millis at the end of the last SPI transaction
+    unsigned long _powerStateChangeTime = 0;//millis at the last power down or wake up
+    uint32_t _awakeTime = 0;                //Total ms spent awake
+    uint32_t _powerDownTime = 0;            //Total ms spent in Deep Power-Down
+    uint32_t _wakeCount = 0;                //Number of releases from Deep Power-Down
+
     sfe_flash_family_e _flashFamily = SFE_FLASH_FAMILY_25XX; //Default but gets set during isConnected
 
     Stream *_debugSerial;           //The stream to send debug messages to if enabled
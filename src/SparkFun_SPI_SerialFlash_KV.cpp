@@ -0,0 +1,709 @@
+/*
+  A small key-value store for configuration data on SPI serial flash, built on SFE_SPI_FLASH
+
+  Records are appended to a log spread over a number of 4KB sectors. Changing a key appends a new
+  record, so no erase is needed until the log is full. Then the oldest sector is compacted: its live
+  records are copied forward and the sector is reused. An open-addressed hash index in RAM is rebuilt
+  when the store is mounted, so each get costs one targeted read.
+
+  https://github.com/sparkfun/SparkFun_SPI_SerialFlash_Arduino_Library
+
+  Development environment specifics:
+  Arduino IDE 1.8.13
+
+  SparkFun code, firmware, and software is released under the MIT License(http://opensource.org/licenses/MIT).
+  The MIT License (MIT)
+  Copyright (c) 2021 SparkFun Electronics
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+  do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial
+  portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+  NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "SparkFun_SPI_SerialFlash_KV.h"
+
+#define SFE_FLASH_KV_ENTRY_EMPTY 0xFFFFFFFF   // Index entry has never been used. Ends a probe
+#define SFE_FLASH_KV_ENTRY_REMOVED 0xFFFFFFFE // Index entry was used and can be reused. Does not end a probe
+
+SFE_SPI_FLASH_KV::SFE_SPI_FLASH_KV(void)
+{
+  // Constructor
+}
+
+SFE_SPI_FLASH_KV::~SFE_SPI_FLASH_KV(void)
+{
+  // Destructor
+  if (_indexAllocated == true)
+    delete[] _index;
+}
+
+//Mount the store, allocating an index with indexSize entries
+bool SFE_SPI_FLASH_KV::begin(SFE_SPI_FLASH &flash, uint32_t baseAddress, uint16_t numSectors, uint16_t indexSize)
+{
+  if ((indexSize < 2) || (indexSize > 32768) || ((indexSize & (indexSize - 1)) != 0))
+    return (false); //Must be a power of two. findKey returns an int16_t
+
+  if ((_indexAllocated == false) || (indexSize != _indexSize))
+  {
+    if (_indexAllocated == true)
+      delete[] _index;
+    _index = new sfe_flash_kv_entry_t[indexSize];
+    _indexAllocated = (_index != NULL);
+    if (_index == NULL)
+      return (false); //Out of RAM
+  }
+  _indexSize = indexSize;
+
+  return (begin(flash, baseAddress, numSectors, _index, indexSize));
+}
+
+//Mount the store, using the caller's index buffer. It must stay valid while the store is in use
+bool SFE_SPI_FLASH_KV::begin(SFE_SPI_FLASH &flash, uint32_t baseAddress, uint16_t numSectors, sfe_flash_kv_entry_t *index, uint16_t indexSize)
+{
+  if ((index == NULL) || (indexSize < 2) || (indexSize > 32768) || ((indexSize & (indexSize - 1)) != 0))
+    return (false);
+
+  if ((numSectors < 2) || ((baseAddress % SFE_FLASH_SECTOR_SIZE) != 0))
+    return (false); //We need a spare sector to compact into
+
+  if ((_indexAllocated == true) && (index != _index))
+  {
+    delete[] _index; //The caller has given us their own buffer
+    _indexAllocated = false;
+  }
+
+  _flash = &flash;
+  _baseAddress = baseAddress;
+  _numSectors = numSectors;
+  _index = index;
+  _indexSize = indexSize;
+
+  return (mount());
+}
+
+//Rebuild the index from the log, and finish any compaction that a power failure cut short
+//Only compaction opens the last free sector, and it retires the old sector before it returns. So if no sector is free,
+//the newest sector holds nothing but a partial copy of the oldest. Erase it to undo the compaction, then compact again.
+//This keeps a free sector to compact into, without relying on space in the head that could be used up later
+bool SFE_SPI_FLASH_KV::mount()
+{
+  if (scanLog() == false)
+    return (false);
+
+  if (countFreeSectors() > 0)
+    return (true);
+
+  if (_flash->eraseSector(sectorAddress(_headSector)) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+
+  if (scanLog() == false)
+    return (false);
+
+  return (compactOldest());
+}
+
+//Rebuild the index from the log
+//The sectors are scanned in sequence order, so later records replace earlier ones.
+//A deleted record frees its key's index entry, so deleted keys take no room in the index
+bool SFE_SPI_FLASH_KV::scanLog()
+{
+  clearIndex();
+  _keyCount = 0;
+
+  uint32_t lastSequence = 0;
+  bool found = false;
+  while (true)
+  {
+    //Find the sector that comes next in the log
+    int16_t nextSector = -1;
+    uint32_t nextSequence = 0;
+    for (uint16_t sector = 0 ; sector < _numSectors ; sector++)
+    {
+      uint32_t sequence;
+      if ((readSectorHeader(sector, &sequence) == true) && (sequence > lastSequence)
+          && ((nextSector < 0) || (sequence < nextSequence)))
+      {
+        nextSector = sector;
+        nextSequence = sequence;
+      }
+    }
+    if (nextSector < 0)
+      break;
+
+    uint16_t endOffset;
+    if (scanSector(nextSector, &endOffset) == false)
+      return (false);
+
+    _headSector = nextSector;
+    _headOffset = endOffset;
+    lastSequence = nextSequence;
+    found = true;
+  }
+
+  _nextSequence = lastSequence + 1;
+
+  if (found == false)
+    return (openSector(0)); //Empty store
+
+  return (true);
+}
+
+//Erase every key
+bool SFE_SPI_FLASH_KV::format()
+{
+  if (_flash == NULL)
+    return (false);
+
+  for (uint16_t sector = 0 ; sector < _numSectors ; sector++)
+  {
+    if (_flash->eraseSector(sectorAddress(sector)) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+    if (_flash->blockingBusyWait(1000) == false)
+      return (false);
+  }
+
+  clearIndex();
+  _keyCount = 0;
+  _nextSequence = 1;
+
+  return (openSector(0));
+}
+
+//Read a value into value. maxSize is the size of value
+//valueSize (if not NULL) returns the stored size. If maxSize is too small, this returns false but valueSize is still set
+//The header, key and value come back in a single read
+bool SFE_SPI_FLASH_KV::get(const char *key, uint8_t *value, uint16_t maxSize, uint16_t *valueSize)
+{
+  size_t keySize = strlen(key);
+  if ((_flash == NULL) || (keySize == 0) || (keySize > SFE_FLASH_KV_MAX_KEY_SIZE))
+    return (false);
+
+  uint16_t hash = hashKey(key, keySize);
+  uint16_t entry = hash & (_indexSize - 1);
+
+  for (uint16_t probe = 0 ; probe < _indexSize ; probe++)
+  {
+    uint32_t address = _index[entry].address;
+    if (address == SFE_FLASH_KV_ENTRY_EMPTY)
+      return (false); //Not found
+
+    if ((address != SFE_FLASH_KV_ENTRY_REMOVED) && (_index[entry].hash == hash))
+    {
+      sfe_flash_kv_record_t record;
+      uint8_t storedKey[SFE_FLASH_KV_MAX_KEY_SIZE];
+      sfe_flash_segment_t segments[3] = {
+        { (uint8_t *)&record, sizeof(record) },
+        { storedKey, (uint16_t)keySize },
+        { value, maxSize }
+      };
+      if (_flash->readv(address, segments, 3) != SFE_FLASH_READ_WRITE_SUCCESS)
+        return (false);
+
+      if ((record.keySize == keySize) && (memcmp(storedKey, key, keySize) == 0)) //Not a hash collision?
+      {
+        if (record.type != SFE_FLASH_KV_TYPE_VALUE)
+          return (false); //Deleted
+
+        if (valueSize != NULL)
+          *valueSize = record.valueSize;
+
+        if (record.valueSize > maxSize)
+          return (false); //Too big for the caller's buffer
+
+        return (record.crc == recordCRC(&record, storedKey, value));
+      }
+    }
+
+    entry = (entry + 1) & (_indexSize - 1);
+  }
+
+  return (false);
+}
+
+//Write a value. The record is appended to the log. Nothing is erased unless the log needs compacting
+bool SFE_SPI_FLASH_KV::set(const char *key, const uint8_t *value, uint16_t valueSize)
+{
+  size_t keySize = strlen(key);
+  if ((_flash == NULL) || (keySize == 0) || (keySize > SFE_FLASH_KV_MAX_KEY_SIZE))
+    return (false);
+
+  uint32_t recordSize = sizeof(sfe_flash_kv_record_t) + keySize + valueSize;
+  if (recordSize > (SFE_FLASH_SECTOR_SIZE - sizeof(sfe_flash_kv_sector_t)))
+    return (false); //Records cannot span sectors
+
+  //Find the index entry first, so we don't write a record we cannot index
+  //Compaction only changes the addresses of entries, so the entry is still ours afterwards
+  uint16_t hash = hashKey(key, keySize);
+  uint8_t oldType = SFE_FLASH_KV_TYPE_DELETED;
+  int16_t entry = findKey(key, keySize, hash, &oldType);
+  if (entry < 0)
+    entry = findFreeEntry(hash);
+  if (entry < 0)
+    return (false); //Index is full
+
+  if (makeRoom(recordSize) == false)
+    return (false);
+
+  uint32_t address;
+  if (appendRecord(key, keySize, SFE_FLASH_KV_TYPE_VALUE, value, valueSize, &address) == false)
+    return (false);
+
+  _index[entry].hash = hash;
+  _index[entry].address = address;
+  if (oldType != SFE_FLASH_KV_TYPE_VALUE)
+    _keyCount++;
+
+  return (true);
+}
+
+//Delete a key by appending a deleted record and freeing its index entry. Returns false if the key does not exist
+bool SFE_SPI_FLASH_KV::remove(const char *key)
+{
+  size_t keySize = strlen(key);
+  if ((_flash == NULL) || (keySize == 0) || (keySize > SFE_FLASH_KV_MAX_KEY_SIZE))
+    return (false);
+
+  uint16_t hash = hashKey(key, keySize);
+  uint8_t oldType;
+  int16_t entry = findKey(key, keySize, hash, &oldType);
+  if ((entry < 0) || (oldType != SFE_FLASH_KV_TYPE_VALUE))
+    return (false);
+
+  if (makeRoom(sizeof(sfe_flash_kv_record_t) + keySize) == false)
+    return (false);
+
+  uint32_t address;
+  if (appendRecord(key, keySize, SFE_FLASH_KV_TYPE_DELETED, NULL, 0, &address) == false)
+    return (false);
+
+  releaseEntry(entry); //Nothing needs to find the deleted record. Compaction drops it
+  _keyCount--;
+
+  return (true);
+}
+
+//Returns the number of keys stored
+uint16_t SFE_SPI_FLASH_KV::getKeyCount()
+{
+  return (_keyCount);
+}
+
+//Add a sector's records to the index. endOffset returns where the next record would go
+//Records that fail their CRC (e.g. torn by a power failure) are skipped
+bool SFE_SPI_FLASH_KV::scanSector(uint16_t sector, uint16_t *endOffset)
+{
+  uint32_t address = sectorAddress(sector);
+  uint16_t offset = sizeof(sfe_flash_kv_sector_t);
+
+  while ((offset + sizeof(sfe_flash_kv_record_t)) <= SFE_FLASH_SECTOR_SIZE)
+  {
+    sfe_flash_kv_record_t record;
+    char key[SFE_FLASH_KV_MAX_KEY_SIZE];
+    sfe_flash_segment_t segments[2] = {
+      { (uint8_t *)&record, sizeof(record) },
+      { (uint8_t *)key, SFE_FLASH_KV_MAX_KEY_SIZE }
+    };
+    if (_flash->readv(address + offset, segments, 2) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+
+    if (record.keySize == 0xFF)
+      break; //Erased. This is the end of the log
+
+    uint32_t recordSize = sizeof(record) + record.keySize + record.valueSize;
+    if ((record.keySize == 0) || (record.keySize > SFE_FLASH_KV_MAX_KEY_SIZE) || ((offset + recordSize) > SFE_FLASH_SECTOR_SIZE))
+    {
+      offset = SFE_FLASH_SECTOR_SIZE; //Torn header. Treat the rest of the sector as used
+      break;
+    }
+
+    //Check the CRC. The value could be large, so read it in chunks
+    uint32_t crc = SFE_SPI_FLASH::crc32(0, (uint8_t *)&record, sizeof(record) - sizeof(record.crc));
+    crc = SFE_SPI_FLASH::crc32(crc, (uint8_t *)key, record.keySize);
+    uint32_t valueAddress = address + offset + sizeof(record) + record.keySize;
+    uint16_t remaining = record.valueSize;
+    uint8_t buffer[32];
+    while (remaining > 0)
+    {
+      uint16_t chunkSize = sizeof(buffer);
+      if (chunkSize > remaining)
+        chunkSize = remaining;
+      if (_flash->readBlock(valueAddress, buffer, chunkSize) != SFE_FLASH_READ_WRITE_SUCCESS)
+        return (false);
+      crc = SFE_SPI_FLASH::crc32(crc, buffer, chunkSize);
+      valueAddress += chunkSize;
+      remaining -= chunkSize;
+    }
+
+    if ((crc == record.crc) && (indexRecord(key, record.keySize, record.type, address + offset) == false))
+      return (false); //Index is full
+
+    offset += recordSize;
+  }
+
+  *endOffset = offset;
+  return (true);
+}
+
+//Write a record at the head of the log. The caller must have called makeRoom
+//writev sends the header, key and value straight from where they are - no staging copy
+bool SFE_SPI_FLASH_KV::appendRecord(const char *key, uint8_t keySize, uint8_t type, const uint8_t *value, uint16_t valueSize, uint32_t *address)
+{
+  sfe_flash_kv_record_t record;
+  record.keySize = keySize;
+  record.type = type;
+  record.valueSize = valueSize;
+  record.crc = recordCRC(&record, (const uint8_t *)key, value);
+
+  sfe_flash_const_segment_t segments[3] = {
+    { (const uint8_t *)&record, sizeof(record) },
+    { (const uint8_t *)key, keySize },
+    { value, valueSize }
+  };
+
+  *address = sectorAddress(_headSector) + _headOffset;
+  if (_flash->writev(*address, segments, 3) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+
+  _headOffset += sizeof(record) + keySize + valueSize;
+  return (true);
+}
+
+//Add or update the index entry for a record found by scanSector
+//A deleted record frees the key's entry, so the index only ever holds keys that exist
+bool SFE_SPI_FLASH_KV::indexRecord(const char *key, uint8_t keySize, uint8_t type, uint32_t address)
+{
+  uint16_t hash = hashKey(key, keySize);
+  int16_t entry = findKey(key, keySize, hash);
+
+  if (type != SFE_FLASH_KV_TYPE_VALUE)
+  {
+    if (entry >= 0)
+    {
+      releaseEntry(entry);
+      _keyCount--;
+    }
+    return (true);
+  }
+
+  if (entry < 0)
+  {
+    entry = findFreeEntry(hash);
+    if (entry < 0)
+      return (false); //Index is full
+    _keyCount++;
+  }
+
+  _index[entry].hash = hash;
+  _index[entry].address = address;
+
+  return (true);
+}
+
+//Make sure the head sector has room for a record
+//Opens a new sector while there are at least two free. Otherwise compacts, to keep one free sector to compact into
+bool SFE_SPI_FLASH_KV::makeRoom(uint16_t recordSize)
+{
+  for (uint16_t attempt = 0 ; attempt <= (2 * _numSectors) ; attempt++)
+  {
+    if (((uint32_t)_headOffset + recordSize) <= SFE_FLASH_SECTOR_SIZE)
+      return (true);
+
+    if (countFreeSectors() > 1)
+    {
+      if (openSector(findFreeSector()) == false)
+        return (false);
+    }
+    else if (compactOldest() == false)
+      return (false);
+  }
+
+  return (false); //Every sector is full of live records
+}
+
+//Copy the live records out of the oldest sector and retire it
+//A record is live if the index points at it. Deleted records never are, so they are dropped. There is nothing older left for them to hide
+//A power failure part way through leaves both copies. The newer one wins when the store is mounted, and mount
+//finishes the compaction if it used up the last free sector
+bool SFE_SPI_FLASH_KV::compactOldest()
+{
+  int16_t oldest = -1;
+  uint32_t oldestSequence = 0;
+  for (uint16_t sector = 0 ; sector < _numSectors ; sector++)
+  {
+    uint32_t sequence;
+    if ((readSectorHeader(sector, &sequence) == true) && ((oldest < 0) || (sequence < oldestSequence)))
+    {
+      oldest = sector;
+      oldestSequence = sequence;
+    }
+  }
+  if (oldest < 0)
+    return (false);
+
+  uint32_t address = sectorAddress(oldest);
+  uint32_t liveSize = 0;
+
+  //Pass 0 adds up the live records. Pass 1 copies them
+  for (uint8_t pass = 0 ; pass < 2 ; pass++)
+  {
+    if (pass == 1)
+    {
+      //Copy into the head if they fit, otherwise into a fresh sector
+      if ((oldest == _headSector) || ((_headOffset + liveSize) > SFE_FLASH_SECTOR_SIZE))
+      {
+        int16_t freeSector = findFreeSector();
+        if ((freeSector < 0) || (openSector(freeSector) == false))
+          return (false);
+      }
+    }
+
+    uint16_t offset = sizeof(sfe_flash_kv_sector_t);
+    while ((offset + sizeof(sfe_flash_kv_record_t)) <= SFE_FLASH_SECTOR_SIZE)
+    {
+      sfe_flash_kv_record_t record;
+      char key[SFE_FLASH_KV_MAX_KEY_SIZE];
+      sfe_flash_segment_t segments[2] = {
+        { (uint8_t *)&record, sizeof(record) },
+        { (uint8_t *)key, SFE_FLASH_KV_MAX_KEY_SIZE }
+      };
+      if (_flash->readv(address + offset, segments, 2) != SFE_FLASH_READ_WRITE_SUCCESS)
+        return (false);
+
+      uint32_t recordSize = sizeof(record) + record.keySize + record.valueSize;
+      if ((record.keySize == 0xFF) || (record.keySize == 0) || (record.keySize > SFE_FLASH_KV_MAX_KEY_SIZE)
+          || ((offset + recordSize) > SFE_FLASH_SECTOR_SIZE))
+        break; //End of the log, or a torn header
+
+      int16_t entry = findAddress(address + offset, hashKey(key, record.keySize));
+      if (entry >= 0) //Only a key's latest value has an entry
+      {
+        if (pass == 0)
+        {
+          liveSize += recordSize;
+        }
+        else
+        {
+          uint32_t newAddress = sectorAddress(_headSector) + _headOffset;
+          if (copyRecord(address + offset, newAddress, recordSize) == false)
+            return (false);
+          _index[entry].address = newAddress;
+          _headOffset += recordSize;
+        }
+      }
+
+      offset += recordSize;
+    }
+  }
+
+  //Retire the old sector by clearing its magic. Programming bits to zero does not need an erase
+  uint8_t retired[4] = { 0, 0, 0, 0 };
+  if (_flash->writeBlock(address, retired, sizeof(retired)) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+
+  return (_flash->blockingBusyWait(100));
+}
+
+//Copy a record to the head of the log
+bool SFE_SPI_FLASH_KV::copyRecord(uint32_t from, uint32_t to, uint16_t recordSize)
+{
+  uint8_t buffer[32];
+  while (recordSize > 0)
+  {
+    uint16_t chunkSize = sizeof(buffer);
+    if (chunkSize > recordSize)
+      chunkSize = recordSize;
+
+    if (_flash->readBlock(from, buffer, chunkSize) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+    sfe_flash_const_segment_t segment = { buffer, chunkSize };
+    if (_flash->writev(to, &segment, 1) != SFE_FLASH_READ_WRITE_SUCCESS) //writev splits at page boundaries
+      return (false);
+
+    from += chunkSize;
+    to += chunkSize;
+    recordSize -= chunkSize;
+  }
+  return (true);
+}
+
+//Erase a sector and make it the head of the log
+bool SFE_SPI_FLASH_KV::openSector(uint16_t sector)
+{
+  if (_flash->eraseSector(sectorAddress(sector)) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+
+  sfe_flash_kv_sector_t header; //writeBlock waits for the erase to complete
+  header.magic = SFE_FLASH_KV_MAGIC;
+  header.sequence = _nextSequence;
+  if (_flash->writeBlock(sectorAddress(sector), (uint8_t *)&header, sizeof(header)) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+
+  _nextSequence++;
+  _headSector = sector;
+  _headOffset = sizeof(header);
+  return (true);
+}
+
+//Returns true if the sector is in use. sequence returns its sequence number
+bool SFE_SPI_FLASH_KV::readSectorHeader(uint16_t sector, uint32_t *sequence)
+{
+  sfe_flash_kv_sector_t header;
+  if (_flash->readBlock(sectorAddress(sector), (uint8_t *)&header, sizeof(header)) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+  *sequence = header.sequence;
+  return ((header.magic == SFE_FLASH_KV_MAGIC) && (header.sequence != 0xFFFFFFFF));
+}
+
+//Returns a sector that is not in use, or -1
+//Starts looking after the head, to spread the wear
+int16_t SFE_SPI_FLASH_KV::findFreeSector()
+{
+  for (uint16_t x = 1 ; x <= _numSectors ; x++)
+  {
+    uint16_t sector = (_headSector + x) % _numSectors;
+    uint32_t sequence;
+    if (readSectorHeader(sector, &sequence) == false)
+      return (sector);
+  }
+  return (-1);
+}
+
+//Returns the number of sectors not in use
+uint16_t SFE_SPI_FLASH_KV::countFreeSectors()
+{
+  uint16_t count = 0;
+  for (uint16_t sector = 0 ; sector < _numSectors ; sector++)
+  {
+    uint32_t sequence;
+    if (readSectorHeader(sector, &sequence) == false)
+      count++;
+  }
+  return (count);
+}
+
+//Returns the index entry for a key, or -1. type returns the type of the key's latest record
+//Only entries with a matching hash are read from flash
+int16_t SFE_SPI_FLASH_KV::findKey(const char *key, uint8_t keySize, uint16_t hash, uint8_t *type)
+{
+  uint16_t entry = hash & (_indexSize - 1);
+
+  for (uint16_t probe = 0 ; probe < _indexSize ; probe++)
+  {
+    uint32_t address = _index[entry].address;
+    if (address == SFE_FLASH_KV_ENTRY_EMPTY)
+      return (-1);
+
+    if ((address != SFE_FLASH_KV_ENTRY_REMOVED) && (_index[entry].hash == hash))
+    {
+      sfe_flash_kv_record_t record;
+      char storedKey[SFE_FLASH_KV_MAX_KEY_SIZE];
+      sfe_flash_segment_t segments[2] = {
+        { (uint8_t *)&record, sizeof(record) },
+        { (uint8_t *)storedKey, keySize }
+      };
+      if ((_flash->readv(address, segments, 2) == SFE_FLASH_READ_WRITE_SUCCESS)
+          && (record.keySize == keySize) && (memcmp(storedKey, key, keySize) == 0))
+      {
+        if (type != NULL)
+          *type = record.type;
+        return (entry);
+      }
+    }
+
+    entry = (entry + 1) & (_indexSize - 1);
+  }
+
+  return (-1);
+}
+
+//Returns the index entry pointing at address, or -1
+int16_t SFE_SPI_FLASH_KV::findAddress(uint32_t address, uint16_t hash)
+{
+  uint16_t entry = hash & (_indexSize - 1);
+
+  for (uint16_t probe = 0 ; probe < _indexSize ; probe++)
+  {
+    if (_index[entry].address == SFE_FLASH_KV_ENTRY_EMPTY)
+      return (-1);
+    if (_index[entry].address == address)
+      return (entry);
+    entry = (entry + 1) & (_indexSize - 1);
+  }
+
+  return (-1);
+}
+
+//Returns an unused index entry, or -1 if the index is full
+int16_t SFE_SPI_FLASH_KV::findFreeEntry(uint16_t hash)
+{
+  uint16_t entry = hash & (_indexSize - 1);
+
+  for (uint16_t probe = 0 ; probe < _indexSize ; probe++)
+  {
+    if ((_index[entry].address == SFE_FLASH_KV_ENTRY_EMPTY) || (_index[entry].address == SFE_FLASH_KV_ENTRY_REMOVED))
+      return (entry);
+    entry = (entry + 1) & (_indexSize - 1);
+  }
+
+  return (-1);
+}
+
+//Mark an index entry as unused
+//If nothing probes past it, it (and any unused entries before it) can go back to never used, keeping probes short
+void SFE_SPI_FLASH_KV::releaseEntry(uint16_t entry)
+{
+  _index[entry].address = SFE_FLASH_KV_ENTRY_REMOVED;
+
+  if (_index[(entry + 1) & (_indexSize - 1)].address != SFE_FLASH_KV_ENTRY_EMPTY)
+    return;
+
+  for (uint16_t x = 0 ; (x < _indexSize) && (_index[entry].address == SFE_FLASH_KV_ENTRY_REMOVED) ; x++)
+  {
+    _index[entry].address = SFE_FLASH_KV_ENTRY_EMPTY;
+    entry = (entry - 1) & (_indexSize - 1);
+  }
+}
+
+//Mark every index entry as never used
+void SFE_SPI_FLASH_KV::clearIndex()
+{
+  for (uint16_t x = 0 ; x < _indexSize ; x++)
+    _index[x].address = SFE_FLASH_KV_ENTRY_EMPTY;
+}
+
+//16-bit FNV-1a hash of a key
+uint16_t SFE_SPI_FLASH_KV::hashKey(const char *key, uint8_t keySize)
+{
+  uint32_t hash = 2166136261UL;
+  for (uint8_t x = 0 ; x < keySize ; x++)
+  {
+    hash ^= (uint8_t)key[x];
+    hash *= 16777619UL;
+  }
+  return ((hash >> 16) ^ (hash & 0xFFFF)); //Fold to 16 bits
+}
+
+//CRC32 of keySize, type, valueSize, the key and the value
+uint32_t SFE_SPI_FLASH_KV::recordCRC(sfe_flash_kv_record_t *record, const uint8_t *key, const uint8_t *value)
+{
+  uint32_t crc = SFE_SPI_FLASH::crc32(0, (uint8_t *)record, sizeof(sfe_flash_kv_record_t) - sizeof(record->crc));
+  crc = SFE_SPI_FLASH::crc32(crc, key, record->keySize);
+  return (SFE_SPI_FLASH::crc32(crc, value, record->valueSize));
+}
+
+//Returns the address of a sector
+uint32_t SFE_SPI_FLASH_KV::sectorAddress(uint16_t sector)
+{
+  return (_baseAddress + ((uint32_t)sector * SFE_FLASH_SECTOR_SIZE));
+}
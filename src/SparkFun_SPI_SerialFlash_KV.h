@@ -0,0 +1,133 @@
+/*
+  A small key-value store for configuration data on SPI serial flash, built on SFE_SPI_FLASH
+
+  Records are appended to a log spread over a number of 4KB sectors. Changing a key appends a new
+  record, so no erase is needed until the log is full. Then the oldest sector is compacted: its live
+  records are copied forward and the sector is reused. An open-addressed hash index in RAM is rebuilt
+  when the store is mounted, so each get costs one targeted read.
+
+  https://github.com/sparkfun/SparkFun_SPI_SerialFlash_Arduino_Library
+
+  Development environment specifics:
+  Arduino IDE 1.8.13
+
+  SparkFun code, firmware, and software is released under the MIT License(http://opensource.org/licenses/MIT).
+  The MIT License (MIT)
+  Copyright (c) 2021 SparkFun Electronics
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+  do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial
+  portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+  NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef SPARKFUN_SPI_FLASH_KV_H
+#define SPARKFUN_SPI_FLASH_KV_H
+
+#include "SparkFun_SPI_SerialFlash.h"
+
+// Default number of entries in the RAM hash index. Must be a power of two. Each entry uses 8 bytes of RAM on most boards.
+// Keep the number of keys below about 3/4 of this for quick lookups. begin can be given a different size, or a buffer
+#ifndef SFE_FLASH_KV_INDEX_SIZE
+#define SFE_FLASH_KV_INDEX_SIZE 128
+#endif
+
+#define SFE_FLASH_KV_MAX_KEY_SIZE 32      // Longest key (not including the NULL)
+#define SFE_FLASH_KV_MAGIC 0x4B565331     // "KVS1" - marks a sector in use
+
+// One entry in the RAM hash index
+typedef struct
+{
+  uint32_t address;   // Address of the key's latest record
+  uint16_t hash;      // Hash of the key
+} sfe_flash_kv_entry_t;
+
+// Record types
+typedef enum
+{
+  SFE_FLASH_KV_TYPE_DELETED = 0x00,
+  SFE_FLASH_KV_TYPE_VALUE = 0x01
+} sfe_flash_kv_type_e;
+
+// Written at the start of each sector in use. The sequence number gives the order of the log
+typedef struct
+{
+  uint32_t magic;     // SFE_FLASH_KV_MAGIC. Cleared to zero when the sector is retired
+  uint32_t sequence;  // Increments with every sector opened
+} sfe_flash_kv_sector_t;
+
+// Record header. The key and then the value follow it
+typedef struct
+{
+  uint8_t keySize;    // 0xFF = erased (no more records in this sector)
+  uint8_t type;       // sfe_flash_kv_type_e
+  uint16_t valueSize;
+  uint32_t crc;       // CRC32 of keySize, type, valueSize, the key and the value
+} sfe_flash_kv_record_t;
+
+class SFE_SPI_FLASH_KV
+{
+
+  public:
+    SFE_SPI_FLASH_KV(void);
+    ~SFE_SPI_FLASH_KV(void);
+
+    bool begin(SFE_SPI_FLASH &flash, uint32_t baseAddress, uint16_t numSectors, uint16_t indexSize = SFE_FLASH_KV_INDEX_SIZE); //Mount the store and rebuild the index. baseAddress must be a multiple of SFE_FLASH_SECTOR_SIZE. numSectors must be at least 2. indexSize must be a power of two
+    bool begin(SFE_SPI_FLASH &flash, uint32_t baseAddress, uint16_t numSectors, sfe_flash_kv_entry_t *index, uint16_t indexSize); //As above, but use the caller's index buffer instead of allocating one
+    bool format(); //Erase every key
+    bool get(const char *key, uint8_t *value, uint16_t maxSize, uint16_t *valueSize = NULL); //Read a value. valueSize returns the stored size, even if maxSize is too small
+    bool set(const char *key, const uint8_t *value, uint16_t valueSize); //Write a value. Only erases if the log needs compacting
+    bool remove(const char *key); //Delete a key
+    uint16_t getKeyCount(); //Returns the number of keys stored
+
+  private:
+
+    SFE_SPI_FLASH_KV(const SFE_SPI_FLASH_KV &); //Not copyable - we may own the index
+    SFE_SPI_FLASH_KV &operator=(const SFE_SPI_FLASH_KV &);
+
+    bool mount(); //Rebuild the index and finish an interrupted compaction
+    bool scanLog(); //Rebuild the index from the log
+    bool scanSector(uint16_t sector, uint16_t *endOffset); //Add a sector's records to the index
+    bool appendRecord(const char *key, uint8_t keySize, uint8_t type, const uint8_t *value, uint16_t valueSize, uint32_t *address); //Write a record at the head of the log
+    bool indexRecord(const char *key, uint8_t keySize, uint8_t type, uint32_t address); //Add or update the index entry for a record
+    bool makeRoom(uint16_t recordSize); //Make sure the head sector has room for a record
+    bool compactOldest(); //Copy the live records out of the oldest sector and retire it
+    bool copyRecord(uint32_t from, uint32_t to, uint16_t recordSize); //Copy a record to the head of the log
+    bool openSector(uint16_t sector); //Erase a sector and make it the head of the log
+    bool readSectorHeader(uint16_t sector, uint32_t *sequence); //Returns true if the sector is in use
+    int16_t findFreeSector(); //Returns a sector that is not in use, or -1
+    uint16_t countFreeSectors(); //Returns the number of sectors not in use
+    int16_t findKey(const char *key, uint8_t keySize, uint16_t hash, uint8_t *type = NULL); //Returns the index entry for a key, or -1
+    int16_t findAddress(uint32_t address, uint16_t hash); //Returns the index entry pointing at address, or -1
+    int16_t findFreeEntry(uint16_t hash); //Returns an unused index entry, or -1
+    void releaseEntry(uint16_t entry); //Mark an index entry as unused
+    void clearIndex(); //Mark every index entry as never used
+    uint16_t hashKey(const char *key, uint8_t keySize); //16-bit FNV-1a hash
+    uint32_t recordCRC(sfe_flash_kv_record_t *record, const uint8_t *key, const uint8_t *value); //CRC32 of a record
+    uint32_t sectorAddress(uint16_t sector); //Returns the address of a sector
+
+    SFE_SPI_FLASH *_flash = NULL;   //The flash we are using
+    uint32_t _baseAddress = 0;      //Start of the first sector
+    uint16_t _numSectors = 0;       //Number of sectors in the store
+
+    uint16_t _headSector = 0;       //The sector new records are appended to
+    uint16_t _headOffset = 0;       //Where the next record goes in that sector
+    uint32_t _nextSequence = 1;     //Sequence number for the next sector opened
+    uint16_t _keyCount = 0;         //Number of keys stored
+
+    sfe_flash_kv_entry_t *_index = NULL;  //The RAM hash index
+    uint16_t _indexSize = 0;              //Number of entries in the index
+    bool _indexAllocated = false;         //True if we allocated _index and need to free it
+};
+
+#endif
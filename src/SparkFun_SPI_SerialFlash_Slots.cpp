@@ -0,0 +1,414 @@
+/*
+  A/B firmware image slots for SPI serial flash, built on SFE_SPI_FLASH
+
+  The flash region is split into two metadata sectors followed by two equal image slots.
+  A new image is streamed into the inactive slot, then committed with a power-fail-safe
+  metadata record. The new image stays pending until it is confirmed, and can be rolled back.
+
+  https://github.com/sparkfun/SparkFun_SPI_SerialFlash_Arduino_Library
+
+  Development environment specifics:
+  Arduino IDE 1.8.13
+
+  SparkFun code, firmware, and software is released under the MIT License(http://opensource.org/licenses/MIT).
+  The MIT License (MIT)
+  Copyright (c) 2021 SparkFun Electronics
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+  do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial
+  portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+  NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "SparkFun_SPI_SerialFlash_Slots.h"
+
+#define SFE_FLASH_SLOT_RECORDS_PER_SECTOR (SFE_FLASH_SECTOR_SIZE / sizeof(sfe_flash_slot_record_t))
+
+SFE_SPI_FLASH_SLOTS::SFE_SPI_FLASH_SLOTS(void)
+{
+  // Constructor
+  memset(&_record, 0, sizeof(_record));
+  _record.activeSlot = SFE_FLASH_SLOT_NONE;
+}
+
+//Set the layout and read the metadata
+//The two metadata sectors start at baseAddress. Slot A follows them, then slot B.
+bool SFE_SPI_FLASH_SLOTS::begin(SFE_SPI_FLASH &flash, uint32_t baseAddress, uint32_t slotSize)
+{
+  if ((slotSize == 0) || ((baseAddress % SFE_FLASH_SECTOR_SIZE) != 0) || ((slotSize % SFE_FLASH_SECTOR_SIZE) != 0))
+    return (false); //Everything has to be erasable one sector at a time
+
+  _flash = &flash;
+  _baseAddress = baseAddress;
+  _slotSize = slotSize;
+  _staging = false;
+  _stagedReady = false;
+
+  return (readMetadata());
+}
+
+//Returns the slot holding the current image
+sfe_flash_slot_e SFE_SPI_FLASH_SLOTS::getActiveSlot()
+{
+  return ((sfe_flash_slot_e)_record.activeSlot);
+}
+
+//Returns the slot the next image will be staged in
+sfe_flash_slot_e SFE_SPI_FLASH_SLOTS::getInactiveSlot()
+{
+  if (_record.activeSlot == SFE_FLASH_SLOT_A)
+    return (SFE_FLASH_SLOT_B);
+  return (SFE_FLASH_SLOT_A);
+}
+
+//Returns true if the active image has been committed but not confirmed
+//If this is true after a restart, the new image did not get as far as confirming itself. Call rollback if it is bad
+bool SFE_SPI_FLASH_SLOTS::isPending()
+{
+  return (_record.state == SFE_FLASH_SLOT_STATE_PENDING);
+}
+
+//Returns the flash address of a slot
+uint32_t SFE_SPI_FLASH_SLOTS::getSlotAddress(sfe_flash_slot_e slot)
+{
+  return (_baseAddress + (2 * SFE_FLASH_SECTOR_SIZE) + (slot == SFE_FLASH_SLOT_B ? _slotSize : 0));
+}
+
+//Returns the size of the image in a slot. 0 = empty
+uint32_t SFE_SPI_FLASH_SLOTS::getImageSize(sfe_flash_slot_e slot)
+{
+  if (slot == SFE_FLASH_SLOT_NONE) return (0);
+  return (_record.imageSize[slot]);
+}
+
+//Returns the CRC32 of the image in a slot
+uint32_t SFE_SPI_FLASH_SLOTS::getImageCRC(sfe_flash_slot_e slot)
+{
+  if (slot == SFE_FLASH_SLOT_NONE) return (0);
+  return (_record.imageCRC[slot]);
+}
+
+//Start streaming a new image into the inactive slot. Refused while the active image is pending
+//The slot is erased one sector at a time as the image arrives
+bool SFE_SPI_FLASH_SLOTS::beginImage(uint32_t imageSize)
+{
+  if ((_flash == NULL) || (imageSize == 0) || (imageSize > _slotSize))
+    return (false);
+
+  if (isPending() == true)
+    return (false); //The inactive slot holds the only image we could roll back to. Confirm or roll back first
+
+  _stagingSlot = getInactiveSlot();
+  _stagingSize = imageSize;
+  _stagingWritten = 0;
+  _stagingCRC = 0;
+  _pageFill = 0;
+  _stagedReady = false;
+  _staging = true;
+
+  return (true);
+}
+
+//Add the next part of the image
+//Full pages are programmed straight away. writeBlock returns as soon as the page has started programming,
+//so the flash programs one page while the application is receiving the next.
+//Erasing a new sector starts as soon as its first byte arrives, for the same reason.
+bool SFE_SPI_FLASH_SLOTS::writeImage(const uint8_t *data, uint16_t dataSize)
+{
+  if (_staging == false)
+    return (false);
+
+  if ((_stagingWritten + _pageFill + dataSize) > _stagingSize)
+  {
+    abortImage(); //Image is bigger than promised
+    return (false);
+  }
+
+  _stagingCRC = SFE_SPI_FLASH::crc32(_stagingCRC, data, dataSize);
+
+  while (dataSize > 0)
+  {
+    if ((_pageFill == 0) && ((_stagingWritten % SFE_FLASH_SECTOR_SIZE) == 0)) //First byte of a new sector?
+    {
+      if (_flash->eraseSector(getSlotAddress(_stagingSlot) + _stagingWritten) != SFE_FLASH_READ_WRITE_SUCCESS)
+      {
+        abortImage();
+        return (false);
+      }
+    }
+
+    uint16_t chunkSize = SFE_FLASH_PAGE_SIZE - _pageFill;
+    if (chunkSize > dataSize)
+      chunkSize = dataSize;
+
+    memcpy(&_pageBuffer[_pageFill], data, chunkSize);
+    _pageFill += chunkSize;
+    data += chunkSize;
+    dataSize -= chunkSize;
+
+    if ((_pageFill == SFE_FLASH_PAGE_SIZE) && (flushPage() == false))
+    {
+      abortImage();
+      return (false);
+    }
+  }
+
+  return (true);
+}
+
+//Write the last page and check the image by reading it back
+//Compare getStagedCRC with the CRC from your download before calling commit
+bool SFE_SPI_FLASH_SLOTS::finishImage()
+{
+  if (_staging == false)
+    return (false);
+
+  _staging = false;
+
+  if ((_stagingWritten + _pageFill) != _stagingSize)
+    return (false); //Image is smaller than promised
+
+  if (flushPage() == false)
+    return (false);
+
+  if (_flash->blockingBusyWait(100) == false) //Wait for the last page to complete
+    return (false);
+
+  //Stash the new size and CRC in the current record (in RAM only) so verifySlot can check them
+  uint32_t oldSize = _record.imageSize[_stagingSlot];
+  uint32_t oldCRC = _record.imageCRC[_stagingSlot];
+  _record.imageSize[_stagingSlot] = _stagingSize;
+  _record.imageCRC[_stagingSlot] = _stagingCRC;
+
+  _stagedReady = verifySlot(_stagingSlot);
+
+  _record.imageSize[_stagingSlot] = oldSize;
+  _record.imageCRC[_stagingSlot] = oldCRC;
+
+  return (_stagedReady);
+}
+
+//Give up on the image being staged. The slot is left partly written, but the metadata still describes the old image
+void SFE_SPI_FLASH_SLOTS::abortImage()
+{
+  _staging = false;
+  _stagedReady = false;
+}
+
+//Returns the CRC32 of the image passed to writeImage so far
+uint32_t SFE_SPI_FLASH_SLOTS::getStagedCRC()
+{
+  return (_stagingCRC);
+}
+
+//Make the staged image active. It stays pending until confirm is called
+//A single metadata record does the switch, so a power failure leaves either the old or the new image active
+bool SFE_SPI_FLASH_SLOTS::commit()
+{
+  if (_stagedReady == false)
+    return (false);
+
+  sfe_flash_slot_record_t record = _record;
+  record.activeSlot = _stagingSlot;
+  record.state = SFE_FLASH_SLOT_STATE_PENDING;
+  record.imageSize[_stagingSlot] = _stagingSize;
+  record.imageCRC[_stagingSlot] = _stagingCRC;
+
+  if (writeRecord(&record) == false)
+    return (false);
+
+  _stagedReady = false;
+  return (true);
+}
+
+//Confirm the pending image
+bool SFE_SPI_FLASH_SLOTS::confirm()
+{
+  if (_record.state != SFE_FLASH_SLOT_STATE_PENDING)
+    return (true); //Nothing to do
+
+  sfe_flash_slot_record_t record = _record;
+  record.state = SFE_FLASH_SLOT_STATE_CONFIRMED;
+  return (writeRecord(&record));
+}
+
+//Switch back to the image in the other slot
+//The other slot is read back first, in case a later image was partly staged over it
+bool SFE_SPI_FLASH_SLOTS::rollback()
+{
+  if (_staging == true)
+    return (false); //Don't roll back to the slot we are writing to
+
+  sfe_flash_slot_e previousSlot = getInactiveSlot();
+  if ((getImageSize(previousSlot) == 0) || (verifySlot(previousSlot) == false))
+    return (false);
+
+  sfe_flash_slot_record_t record = _record;
+  record.activeSlot = previousSlot;
+  record.state = SFE_FLASH_SLOT_STATE_CONFIRMED;
+  _stagedReady = false;
+  return (writeRecord(&record));
+}
+
+//Read a slot back and check its CRC32 against the metadata
+bool SFE_SPI_FLASH_SLOTS::verifySlot(sfe_flash_slot_e slot)
+{
+  if ((_flash == NULL) || (slot == SFE_FLASH_SLOT_NONE) || (_record.imageSize[slot] == 0))
+    return (false);
+
+  uint32_t address = getSlotAddress(slot);
+  uint32_t remaining = _record.imageSize[slot];
+  uint32_t crc = 0;
+  uint8_t buffer[32];
+
+  while (remaining > 0)
+  {
+    uint16_t chunkSize = sizeof(buffer);
+    if (chunkSize > remaining)
+      chunkSize = remaining;
+
+    if (_flash->readBlock(address, buffer, chunkSize) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+    crc = SFE_SPI_FLASH::crc32(crc, buffer, chunkSize);
+
+    address += chunkSize;
+    remaining -= chunkSize;
+  }
+
+  return (crc == _record.imageCRC[slot]);
+}
+
+//Find the current metadata record: the valid record with the highest sequence number
+bool SFE_SPI_FLASH_SLOTS::readMetadata()
+{
+  memset(&_record, 0, sizeof(_record));
+  _record.activeSlot = SFE_FLASH_SLOT_NONE;
+  _record.state = SFE_FLASH_SLOT_STATE_CONFIRMED;
+  _recordSector = 0;
+
+  bool found = false;
+  uint16_t firstErased[2]; //Records are appended, so everything from here on is still erased
+
+  for (uint8_t sector = 0 ; sector < 2 ; sector++)
+  {
+    firstErased[sector] = SFE_FLASH_SLOT_RECORDS_PER_SECTOR;
+
+    for (uint16_t index = 0 ; index < SFE_FLASH_SLOT_RECORDS_PER_SECTOR ; index++)
+    {
+      sfe_flash_slot_record_t record;
+      if (_flash->readBlock(recordAddress(sector, index), (uint8_t *)&record, sizeof(record)) != SFE_FLASH_READ_WRITE_SUCCESS)
+        return (false);
+
+      bool erased = true;
+      for (uint8_t x = 0 ; x < sizeof(record) ; x++)
+      {
+        if (((uint8_t *)&record)[x] != 0xFF)
+        {
+          erased = false;
+          break;
+        }
+      }
+      if (erased == true)
+      {
+        firstErased[sector] = index;
+        break;
+      }
+
+      if ((record.magic == SFE_FLASH_SLOT_MAGIC)
+          && (record.recordCRC == SFE_SPI_FLASH::crc32(0, (uint8_t *)&record, sizeof(record) - sizeof(record.recordCRC)))
+          && ((found == false) || (record.sequence > _record.sequence)))
+      {
+        _record = record;
+        _recordSector = sector;
+        found = true;
+      }
+    }
+  }
+
+  _nextRecord = firstErased[_recordSector];
+
+  return (true);
+}
+
+//Append a new metadata record. Only returns once the record is safely in flash
+//A record torn by a power failure fails its CRC check, leaving the previous record current
+bool SFE_SPI_FLASH_SLOTS::writeRecord(sfe_flash_slot_record_t *record)
+{
+  record->magic = SFE_FLASH_SLOT_MAGIC;
+  record->sequence = _record.sequence + 1;
+  record->reserved = 0xFFFF;
+  record->recordCRC = SFE_SPI_FLASH::crc32(0, (uint8_t *)record, sizeof(sfe_flash_slot_record_t) - sizeof(record->recordCRC));
+
+  //Work out where the record goes, but only update _recordSector and _nextRecord once it has read back correctly
+  uint8_t sector = _recordSector;
+  uint16_t index = _nextRecord;
+
+  for (uint8_t attempt = 0 ; attempt < 2 ; attempt++)
+  {
+    if (index >= SFE_FLASH_SLOT_RECORDS_PER_SECTOR) //No room here. Move to the other sector
+    {
+      if (sector != _recordSector)
+        return (false); //We have already tried a freshly erased sector. Never flip back onto the current record
+
+      //The current record is in _recordSector, so erasing the other sector is safe.
+      //If we lose power before the new record is written, the current record is still there
+      sector = _recordSector ^ 1;
+      if (_flash->eraseSector(recordAddress(sector, 0)) != SFE_FLASH_READ_WRITE_SUCCESS)
+        return (false);
+      index = 0;
+    }
+
+    uint32_t address = recordAddress(sector, index++);
+    if (_flash->writeBlock(address, (uint8_t *)record, sizeof(sfe_flash_slot_record_t)) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+    if (_flash->blockingBusyWait(100) == false)
+      return (false);
+
+    //Read it back. If the location was not fully erased (e.g. after a power failure mid-erase), try a fresh sector
+    sfe_flash_slot_record_t check;
+    if (_flash->readBlock(address, (uint8_t *)&check, sizeof(check)) != SFE_FLASH_READ_WRITE_SUCCESS)
+      return (false);
+    if (memcmp(&check, record, sizeof(check)) == 0)
+    {
+      _record = *record;
+      _recordSector = sector;
+      _nextRecord = index;
+      return (true);
+    }
+
+    index = SFE_FLASH_SLOT_RECORDS_PER_SECTOR;
+  }
+
+  return (false);
+}
+
+//Program the page buffer into the staging slot
+bool SFE_SPI_FLASH_SLOTS::flushPage()
+{
+  if (_pageFill == 0)
+    return (true);
+
+  //If a sector erase is still running, writeBlock waits for it
+  if (_flash->writeBlock(getSlotAddress(_stagingSlot) + _stagingWritten, _pageBuffer, _pageFill) != SFE_FLASH_READ_WRITE_SUCCESS)
+    return (false);
+
+  _stagingWritten += _pageFill;
+  _pageFill = 0;
+  return (true);
+}
+
+//Returns the address of a metadata record
+uint32_t SFE_SPI_FLASH_SLOTS::recordAddress(uint8_t sector, uint16_t index)
+{
+  return (_baseAddress + (sector * SFE_FLASH_SECTOR_SIZE) + (index * sizeof(sfe_flash_slot_record_t)));
+}
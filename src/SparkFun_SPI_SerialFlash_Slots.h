@@ -0,0 +1,119 @@
+/*
+  A/B firmware image slots for SPI serial flash, built on SFE_SPI_FLASH
+
+  The flash region is split into two metadata sectors followed by two equal image slots.
+  A new image is streamed into the inactive slot, then committed with a power-fail-safe
+  metadata record. The new image stays pending until it is confirmed, and can be rolled back.
+
+  https://github.com/sparkfun/SparkFun_SPI_SerialFlash_Arduino_Library
+
+  Development environment specifics:
+  Arduino IDE 1.8.13
+
+  SparkFun code, firmware, and software is released under the MIT License(http://opensource.org/licenses/MIT).
+  The MIT License (MIT)
+  Copyright (c) 2021 SparkFun Electronics
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+  associated documentation files (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the Software is furnished to
+  do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial
+  portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+  NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef SPARKFUN_SPI_FLASH_SLOTS_H
+#define SPARKFUN_SPI_FLASH_SLOTS_H
+
+#include "SparkFun_SPI_SerialFlash.h"
+
+// Image slots
+typedef enum
+{
+  SFE_FLASH_SLOT_A = 0,
+  SFE_FLASH_SLOT_B = 1,
+  SFE_FLASH_SLOT_NONE = 0xFF  // No image has been committed yet
+} sfe_flash_slot_e;
+
+// Slot states
+typedef enum
+{
+  SFE_FLASH_SLOT_STATE_CONFIRMED = 0,  // The active image has been confirmed (or rolled back to)
+  SFE_FLASH_SLOT_STATE_PENDING = 1     // The active image has been committed but not yet confirmed
+} sfe_flash_slot_state_e;
+
+#define SFE_FLASH_SLOT_MAGIC 0x534C4F54 // "SLOT"
+
+// Metadata record. Records are appended to the two metadata sectors in turn.
+// The valid record with the highest sequence number is the current one.
+typedef struct
+{
+  uint32_t magic;         // SFE_FLASH_SLOT_MAGIC
+  uint32_t sequence;      // Increments with every record
+  uint8_t activeSlot;     // sfe_flash_slot_e
+  uint8_t state;          // sfe_flash_slot_state_e
+  uint16_t reserved;      // Pad to a 32-bit boundary
+  uint32_t imageSize[2];  // Size of the image in each slot. 0 = empty
+  uint32_t imageCRC[2];   // CRC32 of the image in each slot
+  uint32_t recordCRC;     // CRC32 of all of the above
+} sfe_flash_slot_record_t;
+
+class SFE_SPI_FLASH_SLOTS
+{
+
+  public:
+    SFE_SPI_FLASH_SLOTS(void);
+
+    bool begin(SFE_SPI_FLASH &flash, uint32_t baseAddress, uint32_t slotSize); //Set the layout and read the metadata. Both must be multiples of SFE_FLASH_SECTOR_SIZE
+    sfe_flash_slot_e getActiveSlot(); //Returns the slot holding the current image
+    sfe_flash_slot_e getInactiveSlot(); //Returns the slot the next image will be staged in
+    bool isPending(); //Returns true if the active image has been committed but not confirmed
+    uint32_t getSlotAddress(sfe_flash_slot_e slot); //Returns the flash address of a slot
+    uint32_t getImageSize(sfe_flash_slot_e slot); //Returns the size of the image in a slot
+    uint32_t getImageCRC(sfe_flash_slot_e slot); //Returns the CRC32 of the image in a slot
+
+    bool beginImage(uint32_t imageSize); //Start streaming a new image into the inactive slot. Refused while the active image is pending
+    bool writeImage(const uint8_t *data, uint16_t dataSize); //Add the next part of the image
+    bool finishImage(); //Write the last page and check the image by reading it back
+    void abortImage(); //Give up on the image being staged
+    uint32_t getStagedCRC(); //Returns the CRC32 of the image passed to writeImage so far
+
+    bool commit(); //Make the staged image active. It stays pending until confirmed
+    bool confirm(); //Confirm the pending image
+    bool rollback(); //Switch back to the image in the other slot
+    bool verifySlot(sfe_flash_slot_e slot); //Read a slot back and check its CRC32
+
+  private:
+
+    bool readMetadata(); //Find the current metadata record
+    bool writeRecord(sfe_flash_slot_record_t *record); //Append a new metadata record
+    bool flushPage(); //Program the page buffer into the staging slot
+    uint32_t recordAddress(uint8_t sector, uint16_t index); //Returns the address of a metadata record
+
+    SFE_SPI_FLASH *_flash = NULL;   //The flash we are using
+    uint32_t _baseAddress = 0;      //Start of the metadata sectors
+    uint32_t _slotSize = 0;         //Size of each slot
+
+    sfe_flash_slot_record_t _record;  //The current metadata record
+    uint8_t _recordSector = 0;        //The metadata sector holding the current record
+    uint16_t _nextRecord = 0;         //Where the next record goes in that sector
+
+    bool _staging = false;            //True between beginImage and finishImage
+    bool _stagedReady = false;        //True once finishImage has checked the image
+    sfe_flash_slot_e _stagingSlot = SFE_FLASH_SLOT_A;
+    uint32_t _stagingSize = 0;        //Size passed to beginImage
+    uint32_t _stagingWritten = 0;     //Bytes programmed so far
+    uint32_t _stagingCRC = 0;         //Running CRC32 of the image
+    uint16_t _pageFill = 0;           //Bytes in _pageBuffer
+    uint8_t _pageBuffer[SFE_FLASH_PAGE_SIZE];
+};
+
+#endif